@@ -30,6 +30,7 @@
 
 #include "xinterpreter.hpp"
 #include "xdebugger.hpp"
+#include "xtrace.hpp"
 
 
 int main(int argc, char* argv[])
@@ -58,6 +59,7 @@ int main(int argc, char* argv[])
     // Registering SIGINT and SIGKILL handlers
     signal(SIGKILL, xpyt::sigkill_handler);
 #endif
+    // Replaced by the cooperative interrupt handler once the interpreter is configured
     signal(SIGINT, xpyt::sigkill_handler);
 
     // Setting Program Name
@@ -103,6 +105,9 @@ int main(int argc, char* argv[])
 
     auto context = xeus::make_context<zmq::context_t>();
 
+    // xserver_shell_main runs the shell on the calling thread
+    xrob::set_trace_thread_name("shell");
+
     if (!connection_filename.empty())
     {
         xeus::xconfiguration config = xeus::load_configuration(connection_filename);
@@ -0,0 +1,177 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xbreakpoint_index.hpp"
+
+namespace xrob
+{
+    breakpoint_index::breakpoint_index()
+        : m_count(0)
+        , m_break_on_failures(false)
+        , m_stepping(false)
+    {
+    }
+
+    void breakpoint_index::set_breakpoints(const std::string& source, std::vector<breakpoint_spec> breakpoints)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_breakpoints.find(source);
+        if (it != m_breakpoints.end())
+        {
+            m_count -= it->second.size();
+            m_breakpoints.erase(it);
+        }
+
+        if (!breakpoints.empty())
+        {
+            m_count += breakpoints.size();
+            m_breakpoints.emplace(source, std::move(breakpoints));
+        }
+    }
+
+    void breakpoint_index::set_break_on_failures(bool enabled)
+    {
+        m_break_on_failures = enabled;
+    }
+
+    void breakpoint_index::set_stepping(bool stepping)
+    {
+        m_stepping = stepping;
+    }
+
+    void breakpoint_index::clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_breakpoints.clear();
+        m_count = 0;
+        m_break_on_failures = false;
+        m_stepping = false;
+    }
+
+    bool breakpoint_index::is_tracing_all() const
+    {
+        return m_stepping || m_break_on_failures;
+    }
+
+    bool breakpoint_index::empty() const
+    {
+        return m_count == 0;
+    }
+
+    bool breakpoint_index::find_breakpoint(const std::string& source, int line, breakpoint_spec& breakpoint) const
+    {
+        if (m_count == 0)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_breakpoints.find(source);
+        if (it == m_breakpoints.end())
+        {
+            return false;
+        }
+
+        for (const breakpoint_spec& spec : it->second)
+        {
+            if (spec.m_line == line)
+            {
+                breakpoint = spec;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::size_t breakpoint_index::add_hit(const std::string& source, int line)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        breakpoint_spec* breakpoint = get_breakpoint(source, line);
+        return breakpoint == nullptr ? 0 : ++breakpoint->m_hits;
+    }
+
+    breakpoint_spec* breakpoint_index::get_breakpoint(const std::string& source, int line)
+    {
+        auto it = m_breakpoints.find(source);
+        if (it != m_breakpoints.end())
+        {
+            for (breakpoint_spec& spec : it->second)
+            {
+                if (spec.m_line == line)
+                {
+                    return &spec;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    breakpoint_index& get_breakpoint_index()
+    {
+        static breakpoint_index index;
+        return index;
+    }
+
+    bool check_hit_condition(const std::string& condition, std::size_t hits)
+    {
+        std::size_t pos = condition.find_first_not_of(" \t");
+        if (pos == std::string::npos)
+        {
+            return true;
+        }
+
+        std::string op;
+        while (pos < condition.size() && std::string("=<>%").find(condition[pos]) != std::string::npos)
+        {
+            op.push_back(condition[pos++]);
+        }
+
+        const char* begin = condition.c_str() + pos;
+        char* end = nullptr;
+        unsigned long long value = std::strtoull(begin, &end, 10);
+        if (end == begin || condition.find_first_not_of(" \t", static_cast<std::size_t>(end - condition.c_str())) != std::string::npos)
+        {
+            return true;
+        }
+
+        std::size_t target = static_cast<std::size_t>(value);
+        if (op.empty() || op == "==")
+        {
+            return hits == target;
+        }
+        if (op == ">")
+        {
+            return hits > target;
+        }
+        if (op == ">=")
+        {
+            return hits >= target;
+        }
+        if (op == "<")
+        {
+            return hits < target;
+        }
+        if (op == "<=")
+        {
+            return hits <= target;
+        }
+        if (op == "%")
+        {
+            return target == 0 || hits % target == 0;
+        }
+        return true;
+    }
+}
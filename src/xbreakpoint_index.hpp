@@ -0,0 +1,82 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_BREAKPOINT_INDEX_HPP
+#define XROB_BREAKPOINT_INDEX_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace xrob
+{
+    struct breakpoint_spec
+    {
+        int m_line = 0;
+        // Robot expression, the breakpoint only hits when it is true
+        std::string m_condition;
+        // Number optionally preceded by ==, >, >=, <, <= or %
+        std::string m_hit_condition;
+        // Log points do not stop, robot variables are replaced in the message
+        std::string m_log_message;
+        std::size_t m_hits = 0;
+    };
+
+    /**
+     * Breakpoints set by the frontend, keyed by source file and line,
+     * and whether the debugger is stepping. It is fed by the debugger on
+     * the control thread and queried by the debug listeners on every
+     * keyword, hence the lock free check when no breakpoint is set.
+     */
+    class breakpoint_index
+    {
+    public:
+
+        breakpoint_index();
+
+        // Replaces the breakpoints of the source, as setBreakpoints does.
+        // Hit counts start over.
+        void set_breakpoints(const std::string& source, std::vector<breakpoint_spec> breakpoints);
+        void set_break_on_failures(bool enabled);
+        void set_stepping(bool stepping);
+        void clear();
+
+        // True if the debug listeners must see every keyword
+        bool is_tracing_all() const;
+        bool empty() const;
+
+        // Copies the breakpoint set at that line, if any
+        bool find_breakpoint(const std::string& source, int line, breakpoint_spec& breakpoint) const;
+
+        // Counts a hit of the breakpoint at that line and returns its hit count
+        std::size_t add_hit(const std::string& source, int line);
+
+    private:
+
+        breakpoint_spec* get_breakpoint(const std::string& source, int line);
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, std::vector<breakpoint_spec>> m_breakpoints;
+        std::atomic<std::size_t> m_count;
+        std::atomic<bool> m_break_on_failures;
+        std::atomic<bool> m_stepping;
+    };
+
+    // Shared by the debugger and the interpreter
+    breakpoint_index& get_breakpoint_index();
+
+    // Invalid hit conditions always hold
+    bool check_hit_condition(const std::string& condition, std::size_t hits);
+}
+
+#endif
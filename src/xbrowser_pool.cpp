@@ -0,0 +1,337 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <string>
+#include <utility>
+
+#include "pybind11/pybind11.h"
+#include "pybind11/eval.h"
+
+#include "xbrowser_pool.hpp"
+
+namespace xrob
+{
+    namespace
+    {
+        // Patches SeleniumLibrary so that plain "Open Browser" calls are served
+        // from a set of sessions refilled in a background thread
+        const char* browser_pool_py = R"py(
+import hashlib
+import json
+import os
+import stat
+import subprocess
+import sys
+import tempfile
+import threading
+
+# Shared with the reaper process. A recorded pid is only signaled while it
+# still runs the driver service executable recorded with it, the pid may
+# have been reused since the handover.
+SERVICE_PROCESS = """
+import os, signal
+
+def is_service_process(pid, executable):
+    if not pid or not executable:
+        return False
+    try:
+        import psutil
+        return os.path.basename(psutil.Process(pid).exe()) == executable
+    except ImportError:
+        pass
+    except Exception:
+        return False
+    try:
+        with open("/proc/%d/cmdline" % pid, "rb") as f:
+            command = f.read().split(b"\\0")[0].decode(errors="replace")
+    except OSError:
+        return False
+    return os.path.basename(command) == executable
+
+def terminate_service(pid, executable):
+    if is_service_process(pid, executable):
+        try:
+            os.kill(pid, signal.SIGTERM)
+        except OSError:
+            pass
+"""
+exec(SERVICE_PROCESS)
+
+REAPER = SERVICE_PROCESS + """
+import json, sys, time, urllib.request
+state_file, timeout = sys.argv[1], float(sys.argv[2])
+time.sleep(timeout)
+try:
+    with open(state_file) as f:
+        sessions = json.load(f)["sessions"]
+    os.remove(state_file)
+except (OSError, ValueError, KeyError):
+    sys.exit(0)
+for session in sessions:
+    try:
+        url = session["executor"] + "/session/" + session["session_id"]
+        urllib.request.urlopen(urllib.request.Request(url, method="DELETE"), timeout=10)
+    except Exception:
+        pass
+    terminate_service(session.get("pid"), session.get("executable"))
+"""
+
+
+def get_state_directory():
+    # Private directory of the user, the state file lists live sessions and
+    # the pids the next kernel and the reaper signal
+    user = os.getuid() if hasattr(os, "getuid") else os.environ.get("USERNAME", "user")
+    directory = os.path.join(tempfile.gettempdir(), "xrobot-%s" % user)
+    try:
+        os.mkdir(directory, 0o700)
+    except FileExistsError:
+        pass
+    info = os.lstat(directory)
+    if not stat.S_ISDIR(info.st_mode):
+        raise OSError("%s is not a directory" % directory)
+    if hasattr(os, "getuid") and (info.st_uid != os.getuid() or info.st_mode & 0o077):
+        raise OSError("%s is not private to the user" % directory)
+    return directory
+
+
+def normalize_browser(name):
+    return str(name).lower().replace(" ", "")
+
+
+def get_executor_url(driver):
+    executor = driver.command_executor
+    config = getattr(executor, "_client_config", None)
+    if config is not None:
+        return config.remote_server_addr
+    return executor._url
+
+
+def get_service_process(driver):
+    service = getattr(driver, "service", None)
+    process = getattr(service, "process", None)
+    if process is not None:
+        return process.pid, os.path.basename(process.args[0] if isinstance(process.args, (list, tuple)) else process.args)
+    return getattr(driver, "_xrobot_service_pid", None), getattr(driver, "_xrobot_service_executable", None)
+
+
+def attach_driver(session):
+    from selenium import webdriver
+    from selenium.webdriver.remote.webdriver import WebDriver
+
+    class AttachedDriver(WebDriver):
+        """Driver connected to a session started by a previous kernel."""
+
+        def start_session(self, capabilities, *args, **kwargs):
+            self.session_id = session["session_id"]
+            self.caps = session["capabilities"]
+
+        def quit(self):
+            try:
+                super().quit()
+            finally:
+                terminate_service(self._xrobot_service_pid, self._xrobot_service_executable)
+
+    browser = normalize_browser(session["capabilities"].get("browserName", ""))
+    options = webdriver.FirefoxOptions() if "firefox" in browser else webdriver.ChromeOptions()
+    driver = AttachedDriver(command_executor=session["executor"], options=options)
+    driver._xrobot_service_pid = session.get("pid")
+    driver._xrobot_service_executable = session.get("executable")
+    return driver
+
+
+class BrowserPool:
+
+    def __init__(self, size, browser, handover, handover_timeout, logger):
+        self.size = size
+        self.browser = normalize_browser(browser)
+        self.handover_timeout = handover_timeout
+        self.logger = logger
+        self.state_file = None
+        if handover:
+            try:
+                cwd_hash = hashlib.md5(os.getcwd().encode("utf-8")).hexdigest()[:12]
+                self.state_file = os.path.join(get_state_directory(), "browser-pool-%s.json" % cwd_hash)
+            except OSError as e:
+                logger.warning("Browser pool handover disabled: %s" % e)
+        self.idle = []
+        self.condition = threading.Condition()
+        self.stopped = False
+        self.create_driver = None
+
+    def start(self):
+        from SeleniumLibrary.keywords.webdrivertools import WebDriverCreator
+
+        self.create_driver = WebDriverCreator.create_driver
+        pool = self
+
+        def create_driver(creator, browser, *args, **kwargs):
+            # Only plain sessions of the pooled browser can be served from the pool
+            plain = not any(args) and not any(kwargs.values())
+            if plain and normalize_browser(browser) == pool.browser:
+                driver = pool.take()
+                if driver is not None:
+                    return driver
+            return pool.create_driver(creator, browser, *args, **kwargs)
+
+        WebDriverCreator.create_driver = create_driver
+        threading.Thread(target=self.run, name="xrobot-browser-pool", daemon=True).start()
+
+    def run(self):
+        from SeleniumLibrary.keywords.webdrivertools import WebDriverCreator
+
+        self.adopt()
+        creator = WebDriverCreator(tempfile.gettempdir())
+        while True:
+            with self.condition:
+                while not self.stopped and len(self.idle) >= self.size:
+                    self.condition.wait()
+                if self.stopped:
+                    return
+            try:
+                driver = self.create_driver(creator, self.browser, None, None)
+            except Exception as e:
+                self.logger.warning("Browser pool disabled, cannot start %s: %s" % (self.browser, e))
+                return
+            with self.condition:
+                self.idle.append(driver)
+
+    def adopt(self):
+        # Claim the sessions handed over by the previous kernel
+        if self.state_file is None:
+            return
+        claimed = "%s.%d" % (self.state_file, os.getpid())
+        try:
+            os.rename(self.state_file, claimed)
+            with open(claimed) as f:
+                sessions = json.load(f)["sessions"]
+            os.remove(claimed)
+        except (OSError, ValueError, KeyError):
+            return
+
+        for session in sessions:
+            try:
+                driver = attach_driver(session)
+                driver.current_url
+            except Exception:
+                continue
+            with self.condition:
+                self.idle.append(driver)
+        self.logger.info("Browser pool adopted %d session(s)" % len(self.idle))
+
+    def take(self):
+        with self.condition:
+            while self.idle:
+                driver = self.idle.pop()
+                try:
+                    driver.current_url
+                except Exception:
+                    continue
+                self.condition.notify()
+                return driver
+        return None
+
+    def handover(self):
+        with self.condition:
+            self.stopped = True
+            self.condition.notify()
+            idle, self.idle = self.idle, []
+
+        if self.state_file is None:
+            for driver in idle:
+                try:
+                    driver.quit()
+                except Exception:
+                    pass
+            return
+
+        sessions = []
+        for driver in idle:
+            try:
+                pid, executable = get_service_process(driver)
+                sessions.append({
+                    "executor": get_executor_url(driver),
+                    "session_id": driver.session_id,
+                    "capabilities": driver.capabilities,
+                    "pid": pid,
+                    "executable": executable,
+                })
+                # Keep the driver service running after the kernel exits
+                service = getattr(driver, "service", None)
+                if service is not None:
+                    service.process = None
+            except Exception:
+                driver.quit()
+
+        if not sessions:
+            return
+
+        # Written next to the state file and renamed, the next kernel never
+        # reads a partial state
+        pending = "%s.%d" % (self.state_file, os.getpid())
+        with open(os.open(pending, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o600), "w") as f:
+            json.dump({"sessions": sessions}, f)
+        os.replace(pending, self.state_file)
+
+        kwargs = {"start_new_session": True} if os.name == "posix" else {"creationflags": subprocess.CREATE_NEW_PROCESS_GROUP}
+        subprocess.Popen(
+            [sys.executable, "-c", REAPER, self.state_file, str(self.handover_timeout)],
+            stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, **kwargs
+        )
+)py";
+    }
+
+    browser_pool::browser_pool(std::size_t size, std::string browser, bool handover, std::size_t handover_timeout)
+        : m_size(size)
+        , m_browser(std::move(browser))
+        , m_handover(handover)
+        , m_handover_timeout(handover_timeout)
+    {
+    }
+
+    void browser_pool::start(const py::object& logger)
+    {
+        if (m_size == 0)
+        {
+            return;
+        }
+
+        m_logger = logger;
+        try
+        {
+            py::dict scope;
+            py::exec(browser_pool_py, scope);
+            m_pool = scope["BrowserPool"](m_size, m_browser, m_handover, m_handover_timeout, m_logger);
+            m_pool.attr("start")();
+        }
+        catch (py::error_already_set& e)
+        {
+            m_pool = py::none();
+            m_logger.attr("warning")("Browser pool disabled: " + std::string(e.what()));
+        }
+    }
+
+    void browser_pool::handover()
+    {
+        if (!m_pool || m_pool.is_none())
+        {
+            return;
+        }
+
+        try
+        {
+            m_pool.attr("handover")();
+        }
+        catch (py::error_already_set& e)
+        {
+            m_logger.attr("warning")("Browser pool handover failed: " + std::string(e.what()));
+        }
+        m_pool = py::none();
+    }
+}
@@ -0,0 +1,57 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_BROWSER_POOL_HPP
+#define XROB_BROWSER_POOL_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Pool of headless SeleniumLibrary browser sessions launched in the
+     * background. "Open Browser" calls for the pooled browser, without
+     * capabilities, options nor remote url, are served from the pool.
+     *
+     * When the handover is enabled, the idle sessions are handed over at
+     * shutdown to the next kernel started in the same directory, through a
+     * state file in a directory private to the user. Sessions not adopted
+     * within the handover timeout are closed by a detached process. Without
+     * handover, the idle sessions are closed at shutdown.
+     *
+     * All the methods must be called with the GIL held.
+     */
+    class browser_pool
+    {
+    public:
+
+        // A size of 0 disables the pool
+        browser_pool(std::size_t size, std::string browser, bool handover, std::size_t handover_timeout);
+
+        void start(const py::object& logger);
+        void handover();
+
+    private:
+
+        std::size_t m_size;
+        std::string m_browser;
+        bool m_handover;
+        std::size_t m_handover_timeout;
+        py::object m_pool;
+        py::object m_logger;
+    };
+}
+
+#endif
@@ -0,0 +1,374 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xcell_classifier.hpp"
+#include "xtokenizer.hpp"
+
+namespace xrob
+{
+    cell_view::cell_view(const char* data, std::size_t size)
+        : p_data(data)
+        , m_size(size)
+    {
+    }
+
+    const char* cell_view::data() const
+    {
+        return p_data;
+    }
+
+    std::size_t cell_view::size() const
+    {
+        return m_size;
+    }
+
+    bool cell_view::empty() const
+    {
+        return m_size == 0;
+    }
+
+    const char* cell_view::begin() const
+    {
+        return p_data;
+    }
+
+    const char* cell_view::end() const
+    {
+        return p_data + m_size;
+    }
+
+    std::string cell_view::str() const
+    {
+        return std::string(p_data, m_size);
+    }
+
+    bool operator==(const cell_view& lhs, const char* rhs)
+    {
+        std::size_t size = std::strlen(rhs);
+        return lhs.size() == size && std::equal(lhs.begin(), lhs.end(), rhs);
+    }
+
+    namespace
+    {
+        const char PYTHON_MODULE_HEADER[] = "%%python module ";
+
+        bool is_module_name_char(char c)
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        }
+
+        // Mirrors the former "^%%python module ([a-zA-Z_]+)" regex
+        bool match_python_module(const std::string& code, cell_info& info)
+        {
+            const std::size_t header_size = sizeof(PYTHON_MODULE_HEADER) - 1;
+            if (code.compare(0, header_size, PYTHON_MODULE_HEADER) != 0)
+            {
+                return false;
+            }
+
+            std::size_t end = header_size;
+            while (end < code.size() && is_module_name_char(code[end]))
+            {
+                ++end;
+            }
+
+            if (end == header_size)
+            {
+                return false;
+            }
+
+            info.m_kind = cell_kind::python_module;
+            info.m_module_name = cell_view(code.data() + header_size, end - header_size);
+            info.m_header_length = end;
+            info.m_body = cell_view(code.data() + end, code.size() - end);
+            return true;
+        }
+
+        std::size_t line_end(const std::string& code, std::size_t pos)
+        {
+            std::size_t end = code.find('\n', pos);
+            return end == std::string::npos ? code.size() : end;
+        }
+
+        bool is_separator_at(const char* prefix, std::size_t i)
+        {
+            // Robot cells are separated by a tab or by two spaces or more
+            char c = prefix[i - 1];
+            return c == '\t' || (c == ' ' && i >= 2 && prefix[i - 2] == ' ');
+        }
+
+        bool find_open_variable(const char* token, std::size_t size, std::size_t& pos)
+        {
+            for (std::size_t i = size; i >= 2; --i)
+            {
+                char c = token[i - 1];
+                if (c == '}')
+                {
+                    return false;
+                }
+                if (c == '{' && std::strchr("$@&%", token[i - 2]) != nullptr)
+                {
+                    pos = i - 2;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Kind of the token being typed at the cursor: the section is tokenized
+        // up to the cursor line, and the line up to the cursor followed by a
+        // placeholder standing for the rest of the token
+        token_kind get_cursor_token_kind(const std::string& code,
+                                         std::size_t section_begin,
+                                         std::size_t line_begin,
+                                         std::size_t offset)
+        {
+            line_state state;
+            std::vector<token> tokens;
+            for (std::size_t pos = section_begin; pos < line_begin;)
+            {
+                std::size_t end = line_end(code, pos);
+                tokens.clear();
+                tokenize_line(code.data() + pos, end - pos, pos, 0, state, tokens);
+                pos = end + 1;
+            }
+
+            std::string line = code.substr(line_begin, offset - line_begin) + "x";
+            std::size_t placeholder = line.size() - 1;
+            tokens.clear();
+            tokenize_line(line.data(), line.size(), 0, 0, state, tokens);
+            auto it = std::find_if(tokens.begin(), tokens.end(), [placeholder](const token& t)
+            {
+                return t.m_offset <= placeholder && placeholder < t.m_offset + t.m_length;
+            });
+            return it == tokens.end() ? token_kind::comment : it->m_kind;
+        }
+    }
+
+    section_kind get_section_kind(const cell_view& header_line)
+    {
+        std::string name;
+        name.reserve(header_line.size());
+        for (char c : header_line)
+        {
+            if (c != '*' && c != ' ' && c != '\t' && c != '\r')
+            {
+                name.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+            }
+        }
+
+        // Robot accepts both the singular and the plural forms
+        if (!name.empty() && name.back() == 's')
+        {
+            name.pop_back();
+        }
+
+        if (name == "setting")
+        {
+            return section_kind::settings;
+        }
+        if (name == "variable")
+        {
+            return section_kind::variables;
+        }
+        if (name == "testcase")
+        {
+            return section_kind::test_cases;
+        }
+        if (name == "task")
+        {
+            return section_kind::tasks;
+        }
+        if (name == "keyword")
+        {
+            return section_kind::keywords;
+        }
+        if (name == "comment")
+        {
+            return section_kind::comments;
+        }
+        return section_kind::unknown;
+    }
+
+    cell_info classify_cell(const std::string& code)
+    {
+        cell_info info;
+        if (match_python_module(code, info))
+        {
+            return info;
+        }
+
+        info.m_body = cell_view(code.data(), code.size());
+
+        std::size_t pos = 0;
+        while (pos < code.size())
+        {
+            std::size_t end = line_end(code, pos);
+            if (code[pos] == '*')
+            {
+                if (!info.m_sections.empty())
+                {
+                    info.m_sections.back().m_end = pos;
+                }
+                section_kind kind = get_section_kind(cell_view(code.data() + pos, end - pos));
+                info.m_sections.push_back({kind, pos, code.size()});
+            }
+            pos = end + 1;
+        }
+
+        return info;
+    }
+
+    std::vector<std::string> get_task_names(const cell_info& cell, const std::string& code)
+    {
+        std::vector<std::string> names;
+        for (const section_range& section : cell.m_sections)
+        {
+            if (section.m_kind != section_kind::tasks && section.m_kind != section_kind::test_cases)
+            {
+                continue;
+            }
+
+            // Skip the header line, names are the non indented lines of the section
+            std::size_t pos = line_end(code, section.m_begin) + 1;
+            while (pos < section.m_end)
+            {
+                std::size_t end = std::min(line_end(code, pos), section.m_end);
+                char first = code[pos];
+                if (end != pos && first != ' ' && first != '\t' && first != '#' && first != '\r')
+                {
+                    // The name may be followed by the first keyword call of the task
+                    std::size_t name_end = pos;
+                    while (name_end < end && !is_separator_at(code.data(), name_end + 1))
+                    {
+                        ++name_end;
+                    }
+                    std::string name = code.substr(pos, name_end - pos);
+                    name.erase(name.find_last_not_of(" \t\r") + 1);
+                    names.push_back(std::move(name));
+                }
+                pos = end + 1;
+            }
+        }
+        return names;
+    }
+
+    std::size_t code_point_to_offset(const std::string& code, int cursor_pos)
+    {
+        std::size_t offset = 0;
+        for (int i = 0; i < cursor_pos && offset < code.size(); ++i)
+        {
+            ++offset;
+            while (offset < code.size() && (static_cast<unsigned char>(code[offset]) & 0xC0) == 0x80)
+            {
+                ++offset;
+            }
+        }
+        return offset;
+    }
+
+    int offset_to_code_point(const std::string& code, std::size_t offset)
+    {
+        int cursor_pos = 0;
+        for (std::size_t i = 0; i < offset && i < code.size(); ++i)
+        {
+            if ((static_cast<unsigned char>(code[i]) & 0xC0) != 0x80)
+            {
+                ++cursor_pos;
+            }
+        }
+        return cursor_pos;
+    }
+
+    cursor_info classify_cursor(const cell_info& cell, const std::string& code, int cursor_pos)
+    {
+        cursor_info info;
+        info.m_offset = code_point_to_offset(code, cursor_pos);
+
+        std::size_t line_begin = info.m_offset == 0 ? std::string::npos : code.rfind('\n', info.m_offset - 1);
+        info.m_line_begin = line_begin == std::string::npos ? 0 : line_begin + 1;
+
+        if (cell.m_kind == cell_kind::python_module)
+        {
+            info.m_context = cursor_context::python;
+            info.m_token_begin = info.m_offset;
+            return info;
+        }
+
+        std::size_t section_begin = 0;
+        for (const section_range& section : cell.m_sections)
+        {
+            if (section.m_begin <= info.m_line_begin)
+            {
+                info.m_section = section.m_kind;
+                section_begin = section.m_begin;
+            }
+        }
+
+        const char* line = code.data() + info.m_line_begin;
+        std::size_t prefix_size = info.m_offset - info.m_line_begin;
+
+        std::size_t token_begin = prefix_size;
+        while (token_begin > 0 && !is_separator_at(line, token_begin))
+        {
+            --token_begin;
+        }
+        info.m_token_begin = info.m_line_begin + token_begin;
+
+        std::size_t variable_pos = 0;
+        if (prefix_size != 0 && line[0] == '*')
+        {
+            info.m_context = cursor_context::header;
+            info.m_token_begin = info.m_line_begin;
+        }
+        else if (find_open_variable(line + token_begin, prefix_size - token_begin, variable_pos))
+        {
+            info.m_context = cursor_context::variable_reference;
+            info.m_token_begin += variable_pos;
+        }
+        else
+        {
+            token_kind kind = info.m_section == section_kind::none
+                ? token_kind::comment
+                : get_cursor_token_kind(code, section_begin, info.m_line_begin, info.m_offset);
+            switch (kind)
+            {
+                case token_kind::name:
+                    info.m_context = cursor_context::definition;
+                    break;
+                case token_kind::setting:
+                    info.m_context = cursor_context::setting;
+                    break;
+                case token_kind::keyword:
+                    info.m_context = cursor_context::keyword_call;
+                    break;
+                case token_kind::variable:
+                    info.m_context = info.m_section == section_kind::variables ? cursor_context::variable
+                                                                                : cursor_context::argument;
+                    break;
+                case token_kind::argument:
+                    info.m_context = cursor_context::argument;
+                    break;
+                default:
+                    info.m_context = cursor_context::other;
+                    break;
+            }
+        }
+
+        return info;
+    }
+}
@@ -0,0 +1,126 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_CELL_CLASSIFIER_HPP
+#define XROB_CELL_CLASSIFIER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace xrob
+{
+    /**
+     * Non-owning view on a range of characters of a cell. The cell
+     * content must outlive the view.
+     */
+    class cell_view
+    {
+    public:
+
+        cell_view() = default;
+        cell_view(const char* data, std::size_t size);
+
+        const char* data() const;
+        std::size_t size() const;
+        bool empty() const;
+
+        const char* begin() const;
+        const char* end() const;
+
+        std::string str() const;
+
+    private:
+
+        const char* p_data = nullptr;
+        std::size_t m_size = 0;
+    };
+
+    bool operator==(const cell_view& lhs, const char* rhs);
+
+    enum class cell_kind
+    {
+        robot,
+        python_module
+    };
+
+    enum class section_kind
+    {
+        none,
+        settings,
+        variables,
+        test_cases,
+        tasks,
+        keywords,
+        comments,
+        unknown
+    };
+
+    enum class cursor_context
+    {
+        python,
+        header,
+        setting,
+        variable,
+        definition,
+        keyword_call,
+        argument,
+        variable_reference,
+        other
+    };
+
+    struct section_range
+    {
+        section_kind m_kind;
+        // Byte offsets of the header line and of the end of the section
+        std::size_t m_begin;
+        std::size_t m_end;
+    };
+
+    struct cell_info
+    {
+        cell_kind m_kind = cell_kind::robot;
+        // Only set for %%python module cells
+        cell_view m_module_name;
+        // Length of the %%python module header, the body starts right after it
+        std::size_t m_header_length = 0;
+        cell_view m_body;
+        std::vector<section_range> m_sections;
+    };
+
+    struct cursor_info
+    {
+        cursor_context m_context = cursor_context::other;
+        section_kind m_section = section_kind::none;
+        // Byte offsets in the cell
+        std::size_t m_offset = 0;
+        std::size_t m_line_begin = 0;
+        std::size_t m_token_begin = 0;
+    };
+
+    // Parses the %%python module header and the robot sections of a cell
+    cell_info classify_cell(const std::string& code);
+
+    // cursor_pos is expressed in unicode code points, as sent by the frontend
+    cursor_info classify_cursor(const cell_info& cell, const std::string& code, int cursor_pos);
+
+    section_kind get_section_kind(const cell_view& header_line);
+
+    // Names of the tasks and test cases defined in a robot cell
+    std::vector<std::string> get_task_names(const cell_info& cell, const std::string& code);
+
+    // Converts a unicode code point position into a byte offset in code
+    std::size_t code_point_to_offset(const std::string& code, int cursor_pos);
+
+    // Converts a byte offset in code into a unicode code point position
+    int offset_to_code_point(const std::string& code, std::size_t offset);
+}
+
+#endif
@@ -0,0 +1,111 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "xcell_classifier.hpp"
+#include "xcompletion_cache.hpp"
+#include "xtokenizer.hpp"
+
+namespace nl = nlohmann;
+
+namespace xrob
+{
+    completion_cache::completion_cache(std::size_t capacity)
+        : m_capacity(capacity)
+    {
+    }
+
+    const nl::json* completion_cache::find(const std::string& key)
+    {
+        auto it = m_index.find(key);
+        if (it == m_index.end())
+        {
+            return nullptr;
+        }
+
+        // Move the entry to the front, it is now the most recently used
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return &(it->second->second);
+    }
+
+    void completion_cache::insert(const std::string& key, nl::json reply)
+    {
+        auto it = m_index.find(key);
+        if (it != m_index.end())
+        {
+            m_entries.erase(it->second);
+            m_index.erase(it);
+        }
+
+        m_entries.emplace_front(key, std::move(reply));
+        m_index[key] = m_entries.begin();
+
+        while (m_entries.size() > m_capacity)
+        {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+    }
+
+    void completion_cache::clear()
+    {
+        m_index.clear();
+        m_entries.clear();
+    }
+
+    std::string get_request_key(const std::string& code,
+                                const cursor_info& cursor,
+                                bool whole_token,
+                                std::size_t generation,
+                                int detail_level)
+    {
+        std::size_t token_end = cursor.m_offset;
+        if (whole_token)
+        {
+            // The key holds the whole token under the cursor
+            std::size_t line_end = code.find('\n', cursor.m_line_begin);
+            line_end = line_end == std::string::npos ? code.size() : line_end;
+            line_state state;
+            state.m_section = cursor.m_section;
+            std::vector<token> tokens;
+            tokenize_line(code.data() + cursor.m_line_begin, line_end - cursor.m_line_begin,
+                          cursor.m_line_begin, 0, state, tokens);
+            for (const token& t : tokens)
+            {
+                if (t.m_offset <= cursor.m_offset && cursor.m_offset < t.m_offset + t.m_length)
+                {
+                    token_end = t.m_offset + t.m_length;
+                }
+            }
+        }
+
+        std::string rest = code.substr(0, cursor.m_token_begin);
+        rest.push_back('\0');
+        rest.append(code, token_end, std::string::npos);
+
+        std::string key = std::to_string(static_cast<int>(cursor.m_context));
+        key += ':' + std::to_string(generation);
+        key += ':' + std::to_string(detail_level);
+        key += ':' + std::to_string(std::hash<std::string>()(rest));
+        key += ':' + code.substr(cursor.m_token_begin, token_end - cursor.m_token_begin);
+        return key;
+    }
+
+    bool is_cacheable(cursor_context context)
+    {
+        return context != cursor_context::variable_reference && context != cursor_context::argument;
+    }
+}
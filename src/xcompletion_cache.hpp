@@ -0,0 +1,72 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_COMPLETION_CACHE_HPP
+#define XROB_COMPLETION_CACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "nlohmann/json.hpp"
+
+#include "xcell_classifier.hpp"
+
+namespace nl = nlohmann;
+
+namespace xrob
+{
+    /**
+     * Bounded LRU cache of complete and inspect replies. It does not
+     * hold Python objects and can be used without the GIL.
+     */
+    class completion_cache
+    {
+    public:
+
+        explicit completion_cache(std::size_t capacity);
+
+        const nl::json* find(const std::string& key);
+        void insert(const std::string& key, nl::json reply);
+        void clear();
+
+    private:
+
+        using entry_list = std::list<std::pair<std::string, nl::json>>;
+
+        entry_list m_entries;
+        std::unordered_map<std::string, entry_list::iterator> m_index;
+        std::size_t m_capacity;
+    };
+
+    /**
+     * Key of a request on the token at the cursor. Besides the token and
+     * its context, it holds the suite generation and a hash of the rest of
+     * the cell, which robotframework_interpreter resolves names against.
+     * The token ends at the cursor when whole_token is false, at the end
+     * of the token under the cursor otherwise.
+     */
+    std::string get_request_key(const std::string& code,
+                                const cursor_info& cursor,
+                                bool whole_token,
+                                std::size_t generation,
+                                int detail_level = 0);
+
+    /**
+     * Whether replies in the given context can be cached. Variables change
+     * on every execution, and arguments may be completed from the state of
+     * the open drivers (e.g. the locators of the current page).
+     */
+    bool is_cacheable(cursor_context context);
+}
+
+#endif
@@ -0,0 +1,302 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+#include "xbreakpoint_index.hpp"
+#include "xdebug_gate.hpp"
+#include "xinternal_utils.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    namespace
+    {
+        // Log point lines are sent in batches, one output event per batch
+        constexpr std::size_t max_log_batch = 64;
+        constexpr std::chrono::milliseconds max_log_delay(100);
+
+        const char* debug_gate_py = R"py(
+import sys
+
+
+def evaluate_condition(condition):
+    from robot.libraries.BuiltIn import BuiltIn
+    try:
+        return bool(BuiltIn().evaluate(condition))
+    except Exception:
+        # A failing condition stops, so that the user sees the error
+        return True
+
+
+def format_log_message(message):
+    from robot.libraries.BuiltIn import BuiltIn
+    try:
+        return BuiltIn().replace_variables(message)
+    except Exception as e:
+        return "%s (%s)" % (message, e)
+
+
+def send_output(adapter, text):
+    try:
+        from robocorp_ls_core.debug_adapter_core.dap.dap_schema import OutputEvent, OutputEventBody
+        adapter.write_message(OutputEvent(OutputEventBody(text, category="console")))
+    except Exception:
+        sys.__stderr__.write(text)
+)py";
+
+        struct keyword_location
+        {
+            std::string m_source;
+            int m_line = -1;
+        };
+
+        py::object get_field(const py::object& item, const char* name, bool is_dict)
+        {
+            if (is_dict)
+            {
+                py::dict attributes = py::reinterpret_borrow<py::dict>(item);
+                return attributes.contains(name) ? py::object(attributes[name]) : py::none();
+            }
+            return py::getattr(item, name, py::none());
+        }
+
+        // Listener API 2 passes (name, attributes), API 3 passes (data, result)
+        keyword_location get_keyword_location(const py::args& args, bool version3)
+        {
+            keyword_location location;
+            if (args.size() < 2)
+            {
+                return location;
+            }
+
+            py::object item = version3 ? py::object(args[0]) : py::object(args[1]);
+            bool is_dict = py::isinstance<py::dict>(item);
+            py::object source = get_field(item, "source", is_dict);
+            py::object line = get_field(item, "lineno", is_dict);
+            if (!source.is_none())
+            {
+                location.m_source = py::str(source).cast<std::string>();
+            }
+            if (py::isinstance<py::int_>(line))
+            {
+                location.m_line = line.cast<int>();
+            }
+            return location;
+        }
+
+        py::dict& get_gate_scope()
+        {
+            return get_embedded_scope(debug_gate_py);
+        }
+
+        // The decisions are shared by the wrappers of all the debug listeners,
+        // so that hits are counted, conditions evaluated and log points printed
+        // once per keyword whatever the number of listeners
+        class debug_gate
+        {
+        public:
+
+            using clock_type = std::chrono::steady_clock;
+
+            debug_gate(breakpoint_index& index, py::object adapter, std::size_t listener_count)
+                : p_index(&index)
+                , m_adapter(std::move(adapter))
+                , m_depths(listener_count, 0)
+            {
+            }
+
+            bool start_keyword(std::size_t listener, const py::args& args, bool version3)
+            {
+                // The first listener to see the keyword decides for the others
+                std::size_t& depth = m_depths[listener];
+                if (depth == m_traced.size())
+                {
+                    m_traced.push_back(decide(args, version3));
+                }
+                return m_traced[depth++];
+            }
+
+            bool end_keyword(std::size_t listener)
+            {
+                // Keywords started before the gate was created were not seen
+                std::size_t& depth = m_depths[listener];
+                if (depth == 0)
+                {
+                    return false;
+                }
+                bool trace = m_traced[--depth];
+
+                // The decision is dropped once all the listeners saw the end
+                std::size_t max_depth = 0;
+                for (std::size_t other : m_depths)
+                {
+                    max_depth = std::max(max_depth, other);
+                }
+                if (max_depth < m_traced.size())
+                {
+                    m_traced.resize(max_depth);
+                    flush_log(m_traced.empty());
+                }
+                return trace;
+            }
+
+        private:
+
+            bool decide(const py::args& args, bool version3)
+            {
+                bool trace = p_index->is_tracing_all();
+
+                // Keyword locations are only read when a breakpoint is set
+                if (!p_index->empty())
+                {
+                    breakpoint_spec breakpoint;
+                    keyword_location location = get_keyword_location(args, version3);
+                    if (p_index->find_breakpoint(location.m_source, location.m_line, breakpoint))
+                    {
+                        trace = hit(location, breakpoint) || trace;
+                    }
+                }
+
+                flush_log(trace);
+                return trace;
+            }
+
+            // Whether the debugger must stop on the breakpoint
+            bool hit(const keyword_location& location, const breakpoint_spec& breakpoint)
+            {
+                py::dict& scope = get_gate_scope();
+                if (!breakpoint.m_condition.empty()
+                    && !scope["evaluate_condition"](breakpoint.m_condition).cast<bool>())
+                {
+                    return false;
+                }
+
+                std::size_t hits = p_index->add_hit(location.m_source, location.m_line);
+                if (!check_hit_condition(breakpoint.m_hit_condition, hits))
+                {
+                    return false;
+                }
+
+                if (!breakpoint.m_log_message.empty())
+                {
+                    if (m_log.empty())
+                    {
+                        m_log_start = clock_type::now();
+                    }
+                    m_log += scope["format_log_message"](breakpoint.m_log_message).cast<std::string>();
+                    m_log += '\n';
+                    ++m_log_lines;
+                    return false;
+                }
+                return true;
+            }
+
+            void flush_log(bool force)
+            {
+                if (m_log.empty())
+                {
+                    return;
+                }
+                if (force || m_log_lines >= max_log_batch || clock_type::now() - m_log_start >= max_log_delay)
+                {
+                    get_gate_scope()["send_output"](m_adapter, m_log);
+                    m_log.clear();
+                    m_log_lines = 0;
+                }
+            }
+
+            breakpoint_index* p_index;
+            py::object m_adapter;
+            // Whether the start of each running keyword is passed on
+            std::vector<bool> m_traced;
+            // Number of running keywords each listener has seen the start of
+            std::vector<std::size_t> m_depths;
+            std::string m_log;
+            std::size_t m_log_lines = 0;
+            clock_type::time_point m_log_start;
+        };
+
+
+        py::object wrap_listener(const py::object& listener,
+                                 const std::shared_ptr<debug_gate>& gate,
+                                 std::size_t listener_index)
+        {
+            py::object version = py::getattr(listener, "ROBOT_LISTENER_API_VERSION", py::int_(2));
+            bool version3 = py::str(version).cast<std::string>() == "3";
+
+            // Events other than the keyword ones go straight to the listener
+            py::dict methods;
+            py::object dir = py::module::import("builtins").attr("dir");
+            for (const py::handle& name : dir(listener))
+            {
+                std::string event = py::str(name).cast<std::string>();
+                py::object method = py::getattr(listener, name);
+                if (event[0] != '_' && PyCallable_Check(method.ptr()))
+                {
+                    methods[name] = method;
+                }
+            }
+            methods["ROBOT_LISTENER_API_VERSION"] = version;
+
+            // A listener missing one of the keyword events would keep the
+            // decisions of the other listeners from being dropped
+            if (!methods.contains("start_keyword") || !methods.contains("end_keyword"))
+            {
+                methods.attr("pop")("start_keyword", py::none());
+                methods.attr("pop")("end_keyword", py::none());
+                return py::module::import("types").attr("SimpleNamespace")(**methods);
+            }
+
+            py::object start_keyword = methods["start_keyword"];
+            methods["start_keyword"] = py::cpp_function([start_keyword, gate, listener_index, version3](py::args args)
+            {
+                if (gate->start_keyword(listener_index, args, version3))
+                {
+                    start_keyword(*args);
+                }
+            });
+
+            py::object end_keyword = methods["end_keyword"];
+            methods["end_keyword"] = py::cpp_function([end_keyword, gate, listener_index](py::args args)
+            {
+                if (gate->end_keyword(listener_index))
+                {
+                    end_keyword(*args);
+                }
+            });
+
+            return py::module::import("types").attr("SimpleNamespace")(**methods);
+        }
+    }
+
+    std::vector<py::object> make_debug_gates(const std::vector<py::object>& listeners,
+                                             breakpoint_index& index,
+                                             const py::object& adapter)
+    {
+        auto gate = std::make_shared<debug_gate>(index, adapter, listeners.size());
+        std::vector<py::object> wrappers;
+        wrappers.reserve(listeners.size());
+        for (std::size_t i = 0; i < listeners.size(); ++i)
+        {
+            wrappers.push_back(wrap_listener(listeners[i], gate, i));
+        }
+        return wrappers;
+    }
+}
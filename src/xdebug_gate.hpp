@@ -0,0 +1,45 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_DEBUG_GATE_HPP
+#define XROB_DEBUG_GATE_HPP
+
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+#include "xbreakpoint_index.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Wraps debug listeners so that they only see the keywords the
+     * debugger can stop on: keywords at a breakpoint whose condition and
+     * hit condition hold, or any keyword while stepping, pausing or
+     * breaking on failures. The other events are passed to the listeners
+     * unchanged. A keyword whose start was not passed on does not have
+     * its end passed on either.
+     *
+     * The wrappers share their decisions: hits are counted and conditions
+     * evaluated once per keyword, by the first listener to see it.
+     *
+     * Log points never stop, their messages are sent in batches as
+     * output events through the debug adapter.
+     *
+     * Must be called with the GIL held.
+     */
+    std::vector<py::object> make_debug_gates(const std::vector<py::object>& listeners,
+                                             breakpoint_index& index,
+                                             const py::object& adapter);
+}
+
+#endif
@@ -8,11 +8,26 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <chrono>
 #include <cstdlib>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 // This must be included BEFORE pybind
 // otherwise it fails to build on Windows
@@ -29,9 +44,12 @@
 
 #include "xeus-zmq/xmiddleware.hpp"
 
+#include "xbreakpoint_index.hpp"
 #include "xdebugger.hpp"
 #include "xrobodebug_client.hpp"
+#include "xtrace.hpp"
 #include "xinternal_utils.hpp"
+#include "xvariable_explorer.hpp"
 
 namespace nl = nlohmann;
 namespace py = pybind11;
@@ -41,6 +59,71 @@ using namespace std::placeholders;
 
 namespace xrob
 {
+    namespace
+    {
+#ifdef _WIN32
+        // Winsock is started once for the process and cleaned up at exit
+        struct winsock_session
+        {
+            winsock_session()
+            {
+                WSADATA wsa_data;
+                m_started = WSAStartup(MAKEWORD(2, 2), &wsa_data) == 0;
+            }
+
+            ~winsock_session()
+            {
+                if (m_started)
+                {
+                    WSACleanup();
+                }
+            }
+
+            bool m_started;
+        };
+#endif
+
+        // Binds a socket to port 0 and reads back the port the system picked.
+        // The port is free again once the socket is closed and another process
+        // may take it before the debug client binds it, the caller asks for it
+        // right before starting the client to keep that window short.
+        std::string get_free_port(const std::string& host)
+        {
+#ifdef _WIN32
+            static winsock_session session;
+            SOCKET fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            bool is_valid = fd != INVALID_SOCKET;
+#else
+            int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            bool is_valid = fd != -1;
+#endif
+            std::string port;
+            if (is_valid)
+            {
+                sockaddr_in address = {};
+                address.sin_family = AF_INET;
+                address.sin_port = 0;
+                inet_pton(AF_INET, host.c_str(), &address.sin_addr);
+
+                socklen_t size = static_cast<socklen_t>(sizeof(address));
+                if (bind(fd, reinterpret_cast<sockaddr*>(&address), size) == 0
+                    && getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size) == 0)
+                {
+                    port = std::to_string(ntohs(address.sin_port));
+                }
+
+#ifdef _WIN32
+                closesocket(fd);
+#else
+                close(fd);
+#endif
+            }
+
+            // Fall back to probing the former port range
+            return port.empty() ? xeus::find_free_port(100, 5678, 5900) : port;
+        }
+    }
+
     debugger::debugger(zmq::context_t& context,
                        const xeus::xconfiguration& config,
                        const std::string& user_name,
@@ -59,9 +142,29 @@ namespace xrob
         , m_robodebug_host("127.0.0.1")
         , m_robodebug_port("")
         , m_debugger_config(debugger_config)
+        , m_is_started(false)
+        , m_start_time(0.)
     {
-        register_request_handler("inspectVariables", std::bind(&debugger::inspect_variables_request, this, _1), false);
-        m_robodebug_port = xeus::find_free_port(100, 5678, 5900);
+        register_traced_handler("inspectVariables", std::bind(&debugger::inspect_variables_request, this, _1), false);
+        // Expands the handles of the variable explorer, forwards the others to the debug adapter
+        register_traced_handler("variables", std::bind(&debugger::variables_request, this, _1), false);
+        // Answered from the replies the client prefetches when the debuggee stops
+        register_traced_handler("stackTrace", std::bind(&debugger::stack_trace_request, this, _1), true);
+        register_traced_handler("scopes", std::bind(&debugger::forward_cached, this, _1), true);
+        // These change variables, the prefetched replies are dropped
+        for (const char* command : {"setVariable", "setExpression", "evaluate"})
+        {
+            register_traced_handler(command, std::bind(&debugger::forward_uncached, this, _1), true);
+        }
+        // Keep the breakpoint index of the debug listeners up to date
+        register_traced_handler("setBreakpoints", std::bind(&debugger::set_breakpoints_request, this, _1), true);
+        register_traced_handler("setExceptionBreakpoints", std::bind(&debugger::set_exception_breakpoints_request, this, _1), true);
+        for (const char* command : {"next", "stepIn", "stepOut", "pause"})
+        {
+            register_traced_handler(command, std::bind(&debugger::step_request, this, _1, true), true);
+        }
+        register_traced_handler("continue", std::bind(&debugger::step_request, this, _1, false), true);
+        register_traced_handler("debugInfo", std::bind(&debugger::debug_info_request, this, _1), false);
     }
 
     debugger::~debugger()
@@ -70,26 +173,65 @@ namespace xrob
         p_robodebug_client = nullptr;
     }
 
+    void debugger::register_traced_handler(const std::string& command,
+                                           const request_handler& handler,
+                                           bool require_started)
+    {
+        register_request_handler(command, [this, handler](const nl::json& message)
+        {
+            // The control thread is created by xeus, it is named by the first request it handles
+            std::call_once(m_control_thread_named, []() { set_trace_thread_name("control"); });
+            trace_span span(message["command"].get<std::string>());
+            return handler(message);
+        }, require_started);
+    }
+
     nl::json debugger::inspect_variables_request(const nl::json& message)
     {
-        py::gil_scoped_acquire acquire;
-        py::object variables = py::globals();
+        nl::json json_vars;
+        {
+            py::gil_scoped_acquire acquire;
+            json_vars = inspect_variables();
+        }
+
+        nl::json reply = {
+            {"type", "response"},
+            {"request_seq", message["seq"]},
+            {"success", true},
+            {"command", message["command"]},
+            {"body", {
+                {"variables", json_vars}
+            }}
+        };
 
-        nl::json json_vars = nl::json::array();
-        for (const py::handle& key : variables)
+        return reply;
+    }
+
+    nl::json debugger::variables_request(const nl::json& message)
+    {
+        const nl::json& arguments = message["arguments"];
+        int reference = arguments["variablesReference"].get<int>();
+        if (!is_explorer_reference(reference))
         {
-            nl::json json_var = nl::json::object();
-            json_var["name"] = py::str(key);
-            json_var["variablesReference"] = 0;
-            try
-            {
-                json_var["value"] = variables[key];
-            }
-            catch(std::exception&)
+            if (!m_is_started)
             {
-                json_var["value"] = py::repr(variables[key]);
+                return {
+                    {"type", "response"},
+                    {"request_seq", message["seq"]},
+                    {"success", false},
+                    {"command", message["command"]},
+                    {"message", "The debugger is not started"}
+                };
             }
-            json_vars.push_back(json_var);
+            return forward_cached(message);
+        }
+
+        nl::json json_vars;
+        {
+            py::gil_scoped_acquire acquire;
+            json_vars = get_explorer_variables(reference,
+                                               arguments.value("start", std::size_t(0)),
+                                               arguments.value("count", std::size_t(0)));
         }
 
         nl::json reply = {
@@ -105,8 +247,141 @@ namespace xrob
         return reply;
     }
 
+    nl::json debugger::stack_trace_request(const nl::json& message)
+    {
+        nl::json reply = forward_cached(message);
+        if (!reply.value("success", false))
+        {
+            return reply;
+        }
+
+        // Hide the frame of the code run by the kernel itself
+        nl::json& body = reply["body"];
+        nl::json& frames = body["stackFrames"];
+        for (std::size_t i = 0; i < frames.size(); ++i)
+        {
+            if (frames[i].value("source", nl::json::object()).value("path", "") == "<string>")
+            {
+                frames.erase(i);
+                if (body.contains("totalFrames") && body["totalFrames"].is_number_integer())
+                {
+                    body["totalFrames"] = body["totalFrames"].get<int>() - 1;
+                }
+                break;
+            }
+        }
+        return reply;
+    }
+
+    nl::json debugger::set_breakpoints_request(const nl::json& message)
+    {
+        // Conditions, hit conditions and log messages are evaluated by the
+        // debug listeners gate, the adapter only gets plain breakpoints
+        nl::json forwarded = message;
+        nl::json& arguments = forwarded["arguments"];
+        if (!arguments.contains("breakpoints"))
+        {
+            arguments["breakpoints"] = nl::json::array();
+        }
+
+        std::vector<breakpoint_spec> breakpoints;
+        for (nl::json& breakpoint : arguments["breakpoints"])
+        {
+            breakpoint_spec spec;
+            spec.m_line = breakpoint["line"].get<int>();
+            spec.m_condition = breakpoint.value("condition", "");
+            spec.m_hit_condition = breakpoint.value("hitCondition", "");
+            spec.m_log_message = breakpoint.value("logMessage", "");
+            breakpoints.push_back(std::move(spec));
+
+            breakpoint.erase("condition");
+            breakpoint.erase("hitCondition");
+            breakpoint.erase("logMessage");
+        }
+        std::string source = arguments["source"].value("path", "");
+        get_breakpoint_index().set_breakpoints(source, std::move(breakpoints));
+        return xdebugger_base::set_breakpoints_request(forwarded);
+    }
+
+    nl::json debugger::set_exception_breakpoints_request(const nl::json& message)
+    {
+        const nl::json& arguments = message["arguments"];
+        get_breakpoint_index().set_break_on_failures(!arguments.value("filters", nl::json::array()).empty());
+        return forward_message(message);
+    }
+
+    nl::json debugger::step_request(const nl::json& message, bool stepping)
+    {
+        get_breakpoint_index().set_stepping(stepping);
+        return forward_message(message);
+    }
+
+    nl::json debugger::debug_info_request(const nl::json& message)
+    {
+        nl::json reply = xdebugger_base::debug_info_request(message);
+        // In seconds, cold is the background import of the debug adapter
+        // modules, warm is the start of the debugger once they are imported
+        reply["body"]["startupTimes"] = {
+            {"cold", m_warmup_time},
+            {"warm", m_start_time}
+        };
+
+        // The adapter only got plain breakpoints, a reconnecting frontend
+        // gets them back with their conditions and log messages
+        nl::json& sources = reply["body"]["breakpoints"];
+        if (sources.is_array())
+        {
+            breakpoint_index& index = get_breakpoint_index();
+            for (nl::json& source : sources)
+            {
+                std::string path = source.value("source", "");
+                for (nl::json& breakpoint : source["breakpoints"])
+                {
+                    breakpoint_spec spec;
+                    if (!index.find_breakpoint(path, breakpoint.value("line", -1), spec))
+                    {
+                        continue;
+                    }
+                    if (!spec.m_condition.empty())
+                    {
+                        breakpoint["condition"] = spec.m_condition;
+                    }
+                    if (!spec.m_hit_condition.empty())
+                    {
+                        breakpoint["hitCondition"] = spec.m_hit_condition;
+                    }
+                    if (!spec.m_log_message.empty())
+                    {
+                        breakpoint["logMessage"] = spec.m_log_message;
+                    }
+                }
+            }
+        }
+        return reply;
+    }
+
+    nl::json debugger::forward_cached(const nl::json& message)
+    {
+        nl::json reply;
+        if (!p_robodebug_client->get_cached_reply(message, reply))
+        {
+            trace_span forward_span("forward to adapter");
+            reply = forward_message(message);
+        }
+        return reply;
+    }
+
+    nl::json debugger::forward_uncached(const nl::json& message)
+    {
+        p_robodebug_client->clear_cache();
+        return forward_message(message);
+    }
+
     bool debugger::start(zmq::socket_t& header_socket, zmq::socket_t& request_socket)
     {
+        trace_span span("debugger start");
+        auto start_time = std::chrono::steady_clock::now();
+
         std::string temp_dir = xeus::get_temp_directory_path();
         std::string log_dir = temp_dir + "/" + "xpython_debug_logs_" + std::to_string(xeus::get_current_pid());
 
@@ -117,13 +392,19 @@ namespace xrob
         request_socket.bind(controller_end_point);
         header_socket.bind(controller_header_end_point);
 
+        // xeus-zmq binds the endpoint of the debug client itself and does not
+        // report the port it got, the port is picked here rather than passed as 0
+        m_robodebug_port = get_free_port(m_robodebug_host);
         std::string robodebug_end_point = "tcp://" + m_robodebug_host + ':' + m_robodebug_port;
-        std::thread client(&xrobodebug_client::start_debugger,
-                           p_robodebug_client,
-                           robodebug_end_point,
-                           publisher_end_point,
-                           controller_end_point,
-                           controller_header_end_point);
+        std::thread client([this, robodebug_end_point, publisher_end_point,
+                            controller_end_point, controller_header_end_point]()
+        {
+            set_trace_thread_name("dap client");
+            p_robodebug_client->start_debugger(robodebug_end_point,
+                                               publisher_end_point,
+                                               controller_end_point,
+                                               controller_header_end_point);
+        });
         client.detach();
 
 
@@ -148,8 +429,8 @@ processor.start_communication_threads(False)
         )";
         std::string init_listener_py = R"(
 from robotframework_debug_adapter.listeners import DebugListener, DebugListenerV2
-debug_listener = DebugListener()
-debug_listenerv2 = DebugListenerV2()
+debug_listener = globals().pop("warm_debug_listener", None) or DebugListener()
+debug_listenerv2 = globals().pop("warm_debug_listenerv2", None) or DebugListenerV2()
         )";
 
         std::string code = var_py + init_logger_py + init_debugger_py + init_listener_py;
@@ -157,7 +438,11 @@ debug_listenerv2 = DebugListenerV2()
         nl::json json_code;
         json_code["port"] = m_robodebug_port;
         json_code["code"] = code;
-        nl::json rep = xdebugger::get_control_messenger().send_to_shell(json_code);
+        nl::json rep;
+        {
+            trace_span shell_span("bootstrap on shell");
+            rep = xdebugger::get_control_messenger().send_to_shell(json_code);
+        }
         std::string status = rep["status"].get<std::string>();
         if(status != "ok")
         {
@@ -172,15 +457,25 @@ debug_listenerv2 = DebugListenerV2()
             std::clog << ename << " - " << evalue << std::endl;
         }
 
+        else
+        {
+            // Set when the adapter modules were imported in the background
+            m_warmup_time = rep.value("warmup_time", nl::json());
+        }
+        m_start_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
         request_socket.send(zmq::message_t("REQ", 3), zmq::send_flags::none);
         zmq::message_t ack;
         (void)request_socket.recv(ack);
 
+        m_is_started = true;
         return true;
     }
 
     void debugger::stop(zmq::socket_t& header_socket, zmq::socket_t& request_socket)
     {
+        m_is_started = false;
+        get_breakpoint_index().clear();
         std::string controller_end_point = xeus::get_controller_end_point("debugger");
         std::string controller_header_end_point = xeus::get_controller_end_point("debugger_header");
         request_socket.unbind(controller_end_point);
@@ -11,9 +11,11 @@
 #ifndef XROB_DEBUGGER_HPP
 #define XROB_DEBUGGER_HPP
 
+#include <functional>
 #include <map>
 #include <mutex>
 #include <set>
+#include <string>
 
 #include "zmq.hpp"
 
@@ -43,7 +45,22 @@ namespace xrob
 
     private:
 
+        using request_handler = std::function<nl::json(const nl::json&)>;
+
+        // Registers a handler recording a trace span named after the command
+        void register_traced_handler(const std::string& command,
+                                     const request_handler& handler,
+                                     bool require_started);
+
         nl::json inspect_variables_request(const nl::json& message);
+        nl::json variables_request(const nl::json& message);
+        nl::json stack_trace_request(const nl::json& message);
+        nl::json forward_cached(const nl::json& message);
+        nl::json forward_uncached(const nl::json& message);
+        nl::json set_breakpoints_request(const nl::json& message);
+        nl::json set_exception_breakpoints_request(const nl::json& message);
+        nl::json step_request(const nl::json& message, bool stepping);
+        nl::json debug_info_request(const nl::json& message);
 
         bool start(zmq::socket_t& header_socket,
                    zmq::socket_t& request_socket) override;
@@ -56,6 +73,13 @@ namespace xrob
         std::string m_robodebug_host;
         std::string m_robodebug_port;
         nl::json m_debugger_config;
+        // Requests forwarded to the debug adapter would wait forever for a
+        // reply while the client is not connected
+        bool m_is_started;
+        // Startup times reported in debugInfo, in seconds
+        double m_start_time;
+        nl::json m_warmup_time;
+        std::once_flag m_control_thread_named;
     };
 
     std::unique_ptr<xeus::xdebugger> make_robot_debugger(xeus::xcontext& context,
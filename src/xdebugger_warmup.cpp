@@ -0,0 +1,88 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include "pybind11/pybind11.h"
+
+#include "xdebugger_warmup.hpp"
+#include "xinternal_utils.hpp"
+
+namespace xrob
+{
+    namespace
+    {
+        const char* debugger_warmup_py = R"py(
+import threading
+import time
+
+
+class Warmup:
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.done = threading.Event()
+        self.started = False
+        self.result = {}
+
+    def start(self):
+        with self.lock:
+            if self.started:
+                return
+            self.started = True
+        threading.Thread(target=self.run, name="xrobot-debugger-warmup", daemon=True).start()
+
+    def run(self):
+        start = time.perf_counter()
+        result = {}
+        try:
+            import robotframework_ls
+            robotframework_ls.import_robocorp_ls_core()
+            import robocorp_ls_core.robotframework_log
+            import robotframework_debug_adapter.run_robot__main__
+            from robotframework_debug_adapter.listeners import DebugListener, DebugListenerV2
+            result["warm_debug_listener"] = DebugListener()
+            result["warm_debug_listenerv2"] = DebugListenerV2()
+            result["warmup_time"] = time.perf_counter() - start
+        except Exception:
+            # Starting the debugger imports them again and reports the error
+            pass
+        with self.lock:
+            self.result = result
+        self.done.set()
+
+    def take(self):
+        with self.lock:
+            if not self.started:
+                return {}
+        # Waiting releases the GIL, the warm-up thread can finish
+        self.done.wait()
+        with self.lock:
+            result, self.result = self.result, {}
+        return result
+)py";
+    }
+
+    void debugger_warmup::start()
+    {
+        if (!m_warmup)
+        {
+            m_warmup = get_embedded_scope(debugger_warmup_py)["Warmup"]();
+        }
+        m_warmup.attr("start")();
+    }
+
+    py::dict debugger_warmup::take()
+    {
+        if (!m_warmup)
+        {
+            return py::dict();
+        }
+        return m_warmup.attr("take")();
+    }
+}
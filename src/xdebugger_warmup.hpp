@@ -0,0 +1,48 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_DEBUGGER_WARMUP_HPP
+#define XROB_DEBUGGER_WARMUP_HPP
+
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Imports the robot debug adapter modules and builds the debug
+     * listeners on a background thread, so that starting the debugger
+     * only has to connect to the adapter.
+     *
+     * The warm-up owns its results, they are handed over by take under
+     * a lock instead of being written to the scope of the debugger
+     * bootstrap. The methods must be called with the GIL held.
+     */
+    class debugger_warmup
+    {
+    public:
+
+        // Starts the warm-up once, later calls do nothing
+        void start();
+
+        // Waits for a started warm-up and returns its results, the
+        // warm_debug_listener and warm_debug_listenerv2 listeners and the
+        // warmup_time in seconds. Returns an empty dict when the warm-up
+        // was not started or failed, and after the results were taken.
+        py::dict take();
+
+    private:
+
+        py::object m_warmup;
+    };
+}
+
+#endif
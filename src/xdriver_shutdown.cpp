@@ -0,0 +1,144 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include "pybind11/pybind11.h"
+
+#include "xdriver_shutdown.hpp"
+#include "xinternal_utils.hpp"
+
+namespace xrob
+{
+    namespace
+    {
+        // Closes the drivers on a pool of daemon threads, each one through the
+        // shutdown of robotframework_interpreter, kills the driver service of
+        // the drivers which do not close before their deadline
+        const char* shutdown_drivers_py = R"py(
+import queue
+import threading
+import time
+
+import robotframework_interpreter
+
+
+def get_driver_name(driver, index):
+    if isinstance(driver, dict):
+        aliases = [alias for alias in driver.get("aliases", []) if alias]
+        name = driver.get("type", "driver")
+        return "%s %s" % (name, aliases[0]) if aliases else "%s #%d" % (name, index)
+    return "driver #%d" % index
+
+
+def kill_driver_process(instance):
+    service = getattr(instance, "service", None)
+    process = getattr(service, "process", None)
+    if process is not None:
+        process.kill()
+        return True
+    pid = getattr(instance, "_xrobot_service_pid", None)
+    if pid:
+        import os
+        import signal
+        os.kill(pid, getattr(signal, "SIGKILL", signal.SIGTERM))
+        return True
+    return False
+
+
+def shutdown_drivers(drivers, worker_count, driver_timeout, total_timeout, logger):
+    if not drivers:
+        return
+
+    start = time.monotonic()
+    condition = threading.Condition()
+    pending = queue.Queue()
+    # index -> [name, driver, started, done]
+    states = []
+    for index, driver in enumerate(drivers):
+        states.append([get_driver_name(driver, index), driver, None, False])
+        pending.put(states[-1])
+
+    def work():
+        while True:
+            try:
+                state = pending.get_nowait()
+            except queue.Empty:
+                return
+            with condition:
+                if state[3]:
+                    continue
+                state[2] = time.monotonic()
+            try:
+                robotframework_interpreter.shutdown_drivers([state[1]])
+                error = None
+            except Exception as e:
+                error = e
+            with condition:
+                if not state[3]:
+                    state[3] = True
+                    elapsed = time.monotonic() - state[2]
+                    if error is None:
+                        logger.info("Closed %s in %.3fs" % (state[0], elapsed))
+                    else:
+                        logger.warning("Failed to close %s in %.3fs: %s" % (state[0], elapsed, error))
+                condition.notify_all()
+
+    # Daemon threads, a hung driver must not block the interpreter exit
+    for i in range(min(worker_count, len(states))):
+        threading.Thread(target=work, name="xrobot-driver-shutdown-%d" % i, daemon=True).start()
+
+    def kill(state, reason):
+        state[3] = True
+        try:
+            driver = state[1]
+            killed = kill_driver_process(driver["instance"] if isinstance(driver, dict) else driver)
+        except Exception:
+            killed = False
+        logger.warning("%s %s after %.3fs%s" % (
+            "Killed" if killed else "Abandoned", state[0], time.monotonic() - start, reason
+        ))
+
+    with condition:
+        while True:
+            now = time.monotonic()
+            if now - start >= total_timeout:
+                for state in states:
+                    if not state[3]:
+                        kill(state, ", shutdown deadline exceeded")
+                break
+
+            next_deadline = start + total_timeout
+            for state in states:
+                if state[3] or state[2] is None:
+                    continue
+                deadline = state[2] + driver_timeout
+                if now >= deadline:
+                    kill(state, ", close deadline exceeded")
+                else:
+                    next_deadline = min(next_deadline, deadline)
+
+            if all(state[3] for state in states):
+                break
+            condition.wait(next_deadline - now)
+
+    logger.info("Shutdown of %d driver(s) took %.3fs" % (len(states), time.monotonic() - start))
+)py";
+    }
+
+    void shutdown_drivers(const py::list& drivers,
+                          std::size_t worker_count,
+                          std::size_t driver_timeout,
+                          std::size_t total_timeout,
+                          const py::object& logger)
+    {
+        py::object shutdown = get_embedded_scope(shutdown_drivers_py)["shutdown_drivers"];
+
+        shutdown(drivers, worker_count == 0 ? 1 : worker_count, driver_timeout, total_timeout, logger);
+    }
+}
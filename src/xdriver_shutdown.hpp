@@ -0,0 +1,38 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_DRIVER_SHUTDOWN_HPP
+#define XROB_DRIVER_SHUTDOWN_HPP
+
+#include <cstddef>
+
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Closes the drivers collected by the connection listeners concurrently,
+     * on up to worker_count threads. A driver still closing after
+     * driver_timeout seconds, or when the whole shutdown exceeds
+     * total_timeout seconds, gets its service process killed. Close times
+     * are reported through the logger.
+     *
+     * Must be called with the GIL held.
+     */
+    void shutdown_drivers(const py::list& drivers,
+                          std::size_t worker_count,
+                          std::size_t driver_timeout,
+                          std::size_t total_timeout,
+                          const py::object& logger);
+}
+
+#endif
@@ -8,6 +8,13 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "pybind11/eval.h"
+
 #include "xeus/xsystem.hpp"
 #include "xinternal_utils.hpp"
 
@@ -29,5 +36,46 @@ namespace xrob
                                        content,
                                        get_tmp_suffix());
     }
-}
 
+    std::string get_cell_hash(const std::string& content)
+    {
+        // The cell temporary file is named after the hash of its content
+        std::string filename = get_cell_tmp_file(content);
+        std::string prefix = get_tmp_prefix();
+        std::size_t begin = filename.compare(0, prefix.size(), prefix) == 0 ? prefix.size() : 0;
+        return filename.substr(begin, filename.size() - begin - get_tmp_suffix().size());
+    }
+
+    std::size_t get_env_size(const char* name, std::size_t default_value)
+    {
+        const char* value = std::getenv(name);
+        if (value == nullptr || *value == '\0')
+        {
+            return default_value;
+        }
+
+        char* end = nullptr;
+        unsigned long long parsed = std::strtoull(value, &end, 10);
+        return *end == '\0' ? static_cast<std::size_t>(parsed) : default_value;
+    }
+
+    std::string get_env_string(const char* name, const std::string& default_value)
+    {
+        const char* value = std::getenv(name);
+        return value == nullptr || *value == '\0' ? default_value : std::string(value);
+    }
+
+    py::dict& get_embedded_scope(const char* code)
+    {
+        // Guarded by the GIL, keyed by the address of the embedded code
+        static std::map<const char*, py::dict*> scopes;
+        py::dict*& scope = scopes[code];
+        if (scope == nullptr)
+        {
+            std::unique_ptr<py::dict> new_scope(new py::dict());
+            py::exec(code, *new_scope);
+            scope = new_scope.release();
+        }
+        return *scope;
+    }
+}
@@ -11,13 +11,31 @@
 #ifndef XROB_INTERNAL_UTILS_HPP
 #define XROB_INTERNAL_UTILS_HPP
 
+#include <cstddef>
 #include <string>
 
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
 namespace xrob
 {
     std::string get_tmp_prefix();
     std::string get_tmp_suffix();
     std::string get_cell_tmp_file(const std::string& content);
+    std::string get_cell_hash(const std::string& content);
+
+    // Reads a numeric setting from the environment of the kernel
+    std::size_t get_env_size(const char* name, std::size_t default_value);
+    std::string get_env_string(const char* name, const std::string& default_value);
+
+    /**
+     * Executes embedded Python code on first use and returns its global scope.
+     * Scopes are never released: a function-local static holding a Python
+     * object would be destroyed after the interpreter is finalized. The GIL
+     * must be held.
+     */
+    py::dict& get_embedded_scope(const char* code);
 }
 
 #endif
@@ -8,9 +8,13 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "nlohmann/json.hpp"
 
@@ -19,6 +23,7 @@
 #include "pybind11/functional.h"
 #include "pybind11/eval.h"
 
+#include "xeus/xcomm.hpp"
 #include "xeus/xguid.hpp"
 
 #include "xeus-python/xinterpreter.hpp"
@@ -26,7 +31,26 @@
 #include "xeus-python/xutils.hpp"
 
 #include "xeus_robot_config.hpp"
+#include "xbreakpoint_index.hpp"
+#include "xcell_classifier.hpp"
+#include "xcompletion_cache.hpp"
+#include "xdebug_gate.hpp"
+#include "xdriver_shutdown.hpp"
 #include "xinternal_utils.hpp"
+#include "xinterrupt.hpp"
+#include "xis_complete.hpp"
+#include "xkeyword_index.hpp"
+#include "xkeyword_indexer.hpp"
+#include "xlibrary_listeners.hpp"
+#include "xlistener_multiplexer.hpp"
+#include "xmodule_registry.hpp"
+#include "xoutput_pool.hpp"
+#include "xparallel.hpp"
+#include "xprogress_coalescer.hpp"
+#include "xreport_store.hpp"
+#include "xresult_summary.hpp"
+#include "xtimings.hpp"
+#include "xtrace.hpp"
 #include "xtraceback.hpp"
 #include "xinterpreter.hpp"
 
@@ -35,16 +59,14 @@ namespace nl = nlohmann;
 namespace py = pybind11;
 using namespace pybind11::literals;
 
-#define PYTHON_MODULE_REGEX "^%%python module ([a-zA-Z_]+)"
 
-
-void safe_cleanup(const py::object& outputdir, const py::object& progress_updater, const py::object& logger) {
+void safe_cleanup(xrob::output_pool& pool, const std::string& outputdir, const py::object& progress_updater, const py::object& logger) {
     // Clean up the passed outputdir, log in cases of errors
     try
     {
-        // Cleanup
-        outputdir.attr("cleanup")();
+        // Cleanup, the output directory is wiped in the background
         progress_updater.attr("clear")();
+        pool.release(outputdir);
     }
     catch (py::error_already_set& e)
     {
@@ -57,9 +79,80 @@ void safe_cleanup(const py::object& outputdir, const py::object& progress_update
 
 namespace xrob
 {
+    // Number of failed tasks listed in the execution error
+    constexpr std::size_t max_reported_failures = 50;
+    // Number of keywords proposed by the native completion
+    constexpr std::size_t max_keyword_completions = 100;
+
+    namespace
+    {
+        // Rebuilds the report of a retained execution from its output.xml
+        const char* build_report_py = R"py(
+import os
+
+from robot.api import ExecutionResult
+
+def build_report(generate_report, directory):
+    suite = ExecutionResult(os.path.join(directory, "output.xml")).suite
+    return generate_report(suite, directory)
+)py";
+
+        // Native matches come first, followed by the other matches of the
+        // robotframework_interpreter reply when both complete the same range
+        nl::json merge_completions(nl::json native, nl::json python)
+        {
+            if (native["matches"].empty())
+            {
+                return python;
+            }
+            if (python["cursor_start"] != native["cursor_start"] || python["cursor_end"] != native["cursor_end"])
+            {
+                return native;
+            }
+
+            std::unordered_set<std::string> names;
+            for (const nl::json& match : native["matches"])
+            {
+                names.insert(normalize_keyword(match.get<std::string>()));
+            }
+
+            nl::json& types = native["metadata"]["_jupyter_types_experimental"];
+            for (const nl::json& match : python["matches"])
+            {
+                if (names.insert(normalize_keyword(match.get<std::string>())).second)
+                {
+                    native["matches"].push_back(match);
+                    types.push_back({
+                        {"start", native["cursor_start"]},
+                        {"end", native["cursor_end"]},
+                        {"text", match}
+                    });
+                }
+            }
+            return native;
+        }
+    }
 
     interpreter::interpreter()
         : xpyt::interpreter()
+        , m_parse_cache(128)
+        , m_output_pool(get_env_size("XROBOT_OUTPUT_POOL_SIZE", 4),
+                        get_env_size("XROBOT_OUTPUT_POOL_MAX_BYTES", std::size_t(512) << 20))
+        , m_lazy_report(get_env_size("XROBOT_LAZY_REPORT", 0) != 0)
+        , m_report_store(32)
+        , m_progress_coalescer(get_env_size("XROBOT_PROGRESS_FPS", 10))
+        , m_parallel_workers(get_env_size("XROBOT_PARALLEL_WORKERS", 0))
+        , m_parallel_timeout(get_env_size("XROBOT_PARALLEL_TIMEOUT", 3600))
+        , m_completion_cache(256)
+        , m_suite_generation(0)
+        , m_browser_pool(get_env_size("XROBOT_BROWSER_POOL_SIZE", 0),
+                         get_env_string("XROBOT_BROWSER_POOL_BROWSER", "headlesschrome"),
+                         get_env_size("XROBOT_BROWSER_POOL_HANDOVER", 0) != 0,
+                         get_env_size("XROBOT_BROWSER_POOL_HANDOVER_TIMEOUT", 60))
+        , m_shutdown_workers(get_env_size("XROBOT_SHUTDOWN_WORKERS", 8))
+        , m_driver_shutdown_timeout(get_env_size("XROBOT_DRIVER_SHUTDOWN_TIMEOUT", 5))
+        , m_shutdown_timeout(get_env_size("XROBOT_SHUTDOWN_TIMEOUT", 10))
+        , m_debugger_warmup_enabled(get_env_size("XROBOT_DEBUGGER_WARMUP", 1) != 0)
     {
     }
 
@@ -91,23 +184,81 @@ namespace xrob
         m_keywords_listener = robot_interpreter.attr("RobotKeywordsIndexerListener")();
         m_listeners.append(m_keywords_listener);
 
+        // Native keyword index used for completion
+        m_listener_multiplexer.add(make_keyword_indexer(m_keyword_index));
+
         m_return_value_listener = robot_interpreter.attr("ReturnValueListener")();
-        m_listeners.append(m_return_value_listener);
+        m_listener_multiplexer.add(m_return_value_listener);
 
         m_status_listener = robot_interpreter.attr("StatusEventListener")();
-        m_listeners.append(m_status_listener);
+        m_listener_multiplexer.add(m_status_listener);
 
         m_listeners.append(robot_interpreter.attr("GlobalVarsListener")());
 
-        // Library listeners
-        m_listeners.append(robot_interpreter.attr("SeleniumConnectionsListener")(m_drivers));
-        m_listeners.append(robot_interpreter.attr("PlaywrightConnectionsListener")(m_drivers));
-        m_listeners.append(robot_interpreter.attr("JupyterConnectionsListener")(m_drivers));
-        m_listeners.append(robot_interpreter.attr("AppiumConnectionsListener")(m_drivers));
-        m_listeners.append(robot_interpreter.attr("WhiteLibraryListener")(m_drivers));
+        // Library listeners, attached when their library is first imported
+        m_listener_multiplexer.add(m_library_listeners.make_hook(m_listener_multiplexer, m_drivers));
 
         m_debug_adapter = py::none();
 
+        // Serve the robot models of already executed cells from the parse cache
+        py::module robot_interpreter_impl = py::module::import("robotframework_interpreter.interpreter");
+        if (py::hasattr(robot_interpreter_impl, "get_model"))
+        {
+            py::object get_model = robot_interpreter_impl.attr("get_model");
+            robot_interpreter_impl.attr("get_model") = py::cpp_function(
+                [this, get_model](py::object source, py::kwargs kwargs)
+                {
+                    return parse_cell(get_model, source, kwargs);
+                }
+            );
+        }
+
+        // Measure the report generation separately from the run
+        if (py::hasattr(robot_interpreter_impl, "generate_report"))
+        {
+            py::object generate_report = robot_interpreter_impl.attr("generate_report");
+            robot_interpreter_impl.attr("generate_report") = py::cpp_function(
+                [this, generate_report](py::args args, py::kwargs kwargs)
+                {
+                    return build_report(generate_report, args, kwargs);
+                }
+            );
+        }
+
+        // Reports retained in lazy mode are built on demand through this comm
+        comm_manager().register_comm_target("xrobot.report", [this](xeus::xcomm&& comm, xeus::xmessage)
+        {
+            erase_closed_comms();
+            xeus::xguid id = comm.id();
+            comm.on_message([this, id](const xeus::xmessage& message)
+            {
+                handle_report_message(id, message);
+            });
+            comm.on_close([this, id](const xeus::xmessage&)
+            {
+                m_closed_comms.push_back(id);
+            });
+            m_report_comms.emplace(id, std::move(comm));
+        });
+
+        // Timeline of the kernel threads, see xtrace.hpp
+        comm_manager().register_comm_target("xrobot.trace", [this](xeus::xcomm&& comm, xeus::xmessage)
+        {
+            erase_closed_comms();
+            xeus::xguid id = comm.id();
+            comm.on_message([this, id](const xeus::xmessage& message)
+            {
+                handle_trace_message(id, message);
+            });
+            comm.on_close([this, id](const xeus::xmessage&)
+            {
+                m_closed_comms.push_back(id);
+            });
+            m_trace_comms.emplace(id, std::move(comm));
+        });
+
+        m_output_pool.start();
+
         // Format and redirect all logging to the terminal
         py::object formatter = formatter_cls(
             "fmt"_a= "%(asctime)s.%(msecs)03d › %(levelname)s › %(name)s › %(process)d › %(message)s",
@@ -122,6 +273,8 @@ namespace xrob
 
         logging.attr("getLogger")().attr("handlers") = handlers;
         m_logger.attr("handlers") = handlers;
+
+        m_browser_pool.start(m_logger);
     }
 
     nl::json interpreter::execute_request_impl(
@@ -132,24 +285,33 @@ namespace xrob
         nl::json /*user_expressions*/,
         bool /*allow_stdin*/)
     {
-        // Acquire GIL before executing code
-        py::gil_scoped_acquire acquire;
+        trace_span span("execute_request");
 
+        cell_info cell = classify_cell(code);
         std::string filename = get_cell_tmp_file(code);
+        std::string cell_hash = get_cell_hash(code);
+
+        // Acquire GIL before executing code
+        py::gil_scoped_acquire acquire;
 
         // If it's Python code
-        py::module re = py::module::import("re");
-        py::object match = re.attr("match")(PYTHON_MODULE_REGEX, code);
-        if (!match.is_none())
+        if (cell.m_kind == cell_kind::python_module)
         {
-            py::object modulename = py::list(match.attr("groups")())[0];
-
-            // Extract Python code from the cell
-            std::string python_code = code;
-            python_code.erase(0, py::list(match.attr("span")())[1].cast<int>());
+            m_phase_timer.reset();
+            nl::json kernel_res = execute_python(cell.m_body.str(), py::str(cell.m_module_name.str()), filename, silent);
+            end_execution(kernel_res);
+            return kernel_res;
+        }
 
-            return execute_python(python_code, modulename, filename, silent);
+        // Cells only made of independent tasks can be sharded across worker processes
+        std::vector<std::string> tasks;
+        if (m_parallel_workers > 1 && is_task_only_cell(cell))
+        {
+            tasks = get_task_names(cell, code);
         }
+        bool parallel = tasks.size() > 1;
+
+        m_phase_timer.reset();
 
         // Maps source file for debugger/traceback
         xpyt::register_filename_mapping(filename, execution_count);
@@ -157,7 +319,7 @@ namespace xrob
 
         nl::json kernel_res;
 
-        py::object outputdir = py::module::import("tempfile").attr("TemporaryDirectory")();
+        std::string outputdir = m_output_pool.acquire();
         py::module robot_interpreter = py::module::import("robotframework_interpreter");
         py::object partial = py::module::import("functools").attr("partial");
 
@@ -166,30 +328,102 @@ namespace xrob
 
         py::module display = py::module::import("IPython.display");
 
+        // Progress updates are throttled to the configured frame rate
+        m_progress_coalescer.start(partial(display.attr("update_display"), "raw"_a=true, "display_id"_a=display_id));
         py::object progress_updater = robot_interpreter.attr("ProgressUpdater")(
             partial(display.attr("display"), "raw"_a=true, "display_id"_a=display_id),
-            partial(display.attr("update_display"), "raw"_a=true, "display_id"_a=display_id)
+            py::cpp_function([this](py::args args, py::kwargs kwargs)
+            {
+                m_progress_coalescer.push(std::move(args), std::move(kwargs));
+            })
         );
         m_status_listener.attr("callback") = progress_updater.attr("update");
 
         // Get execution result
         py::list result;
+        m_parse_cache_key = cell_hash;
+        m_parsed_cell_key.clear();
+        m_outputdir = outputdir;
+        phase_timer::clock_type::time_point run_start = phase_timer::clock_type::now();
         try
         {
-            result = robot_interpreter.attr("execute")(
-                code, m_test_suite, "listeners"_a=m_listeners, "drivers"_a=m_drivers,
-                "outputdir"_a=outputdir.attr("name"), "logger"_a=m_logger
-            );
+            start_robot_run();
+            try
+            {
+                if (parallel)
+                {
+                    // The workers run out of process, the listeners see nothing of them
+                    py::object run_result = run_sharded_tasks(
+                        m_session_definitions, code, tasks, m_parallel_workers,
+                        m_test_suite.attr("name").cast<std::string>(), outputdir, m_parallel_timeout
+                    );
+
+                    // The report is generated from the combined suite, the session suite
+                    // keeps its own mode
+                    py::object run_suite = run_result.attr("suite");
+                    run_suite.attr("rpa") = std::any_of(cell.m_sections.begin(), cell.m_sections.end(), [](const section_range& s)
+                    {
+                        return s.m_kind == section_kind::tasks;
+                    });
+                    result.append(run_result);
+                    result.append(py::module::import("robotframework_interpreter.interpreter").attr("generate_report")(run_suite, outputdir));
+                }
+                else
+                {
+                    // Listeners needing the event dispatch are grouped in the multiplexer,
+                    // robot gets one listener per API version
+                    py::list listeners = m_listener_multiplexer.make_listeners(m_listeners);
+                    result = robot_interpreter.attr("execute")(
+                        code, m_test_suite, "listeners"_a=listeners, "drivers"_a=m_drivers,
+                        "outputdir"_a=outputdir, "logger"_a=m_logger
+                    );
+                }
+            }
+            catch (py::error_already_set&)
+            {
+                end_robot_run();
+                throw;
+            }
+            end_robot_run();
+
+            // Definitions are replayed in the workers of the next parallel executions
+            m_session_definitions.add_cell(cell, code);
+
+            // The cell is cached under the key parse_cell resolved, not its bare hash
+            const parsed_cell* parsed = m_parsed_cell_key.empty() ? nullptr : m_parse_cache.find(m_parsed_cell_key);
+            if (parsed != nullptr && !parsed->m_keywords.empty())
+            {
+                m_keyword_index.add_keywords(m_test_suite.attr("name").cast<std::string>(), parsed->m_keywords);
+                // Redefined keywords may have a new documentation
+                ++m_suite_generation;
+            }
+            bump_generation_on_imports();
+            m_parse_cache_key.clear();
+            m_parsed_cell_key.clear();
+            m_outputdir.clear();
+            m_progress_coalescer.finish();
         }
         // Execution error (e.g. lib import failed)
         catch (py::error_already_set& e)
         {
-            safe_cleanup(outputdir, progress_updater, m_logger);
+            bump_generation_on_imports();
+            m_parse_cache_key.clear();
+            m_parsed_cell_key.clear();
+            m_outputdir.clear();
+            m_pending_report.clear();
+            m_progress_coalescer.finish();
+            record_run_phase(run_start);
+
+            {
+                scoped_phase phase(m_phase_timer, execution_phase::cleanup);
+                safe_cleanup(m_output_pool, outputdir, progress_updater, m_logger);
+            }
 
             xpyt::xerror error = extract_robot_error(e);
 
             if (!silent)
             {
+                scoped_phase phase(m_phase_timer, execution_phase::publish);
                 publish_execution_error(error.m_ename, error.m_evalue, error.m_traceback);
             }
 
@@ -198,8 +432,12 @@ namespace xrob
             kernel_res["evalue"] = error.m_evalue;
             kernel_res["traceback"] = error.m_traceback;
 
+            end_execution(kernel_res);
             return kernel_res;
         }
+        record_run_phase(run_start);
+
+        scoped_phase publish_phase(m_phase_timer, execution_phase::publish);
 
         // If the result is None, it means the suite has not been executed, instead
         // widgets have been created
@@ -213,66 +451,242 @@ namespace xrob
         // Otherwise, publish tests report if there is one, stop the execution if tests failed
         else
         {
+            result_summary summary = summarize_result(result[0].attr("suite"), max_reported_failures);
+            kernel_res["tasks"] = summary.to_json();
+
             if (!result[1].is_none())
             {
                 publish_execution_result(execution_count, result[1], nl::json::object());
             }
-
-            bool failed = false;
-            xpyt::xerror error;
-            error.m_ename = "Task(s) failed";
-            error.m_evalue = "Task(s) failed";
-            error.m_traceback.push_back(first_error_delimiter(error.m_ename));
-            for (const py::handle& test: result[0].attr("suite").attr("tests"))
+            else if (!m_pending_report.empty() && !silent)
             {
-                if ((py::hasattr(test, "failed") && xpyt::is_pyobject_true(test.attr("failed"))) ||
-                    (py::hasattr(test, "passed") && !xpyt::is_pyobject_true(test.attr("passed"))))
-                {
-                    failed = true;
-
-                    std::stringstream error_msg;
-                    error_msg << "Task " << blue_text(py::str(test.attr("name")).cast<std::string>())
-                        << " failed with: " << py::str(test.attr("message")).cast<std::string>();
-
-                    error.m_traceback.push_back(error_msg.str());
-                }
+                publish_report_summary(execution_count, summary, m_pending_report);
             }
+            m_pending_report.clear();
 
-            if (failed)
+            if (summary.m_failed != 0)
             {
+                xpyt::xerror error;
+                error.m_ename = "Task(s) failed";
+                error.m_evalue = "Task(s) failed";
+                error.m_traceback = get_failure_traceback(summary, error.m_ename);
+
                 if (!silent)
                 {
-                    error.m_traceback.push_back(last_error_delimiter());
                     publish_execution_error(error.m_ename, error.m_evalue, error.m_traceback);
                 }
+                publish_phase.stop();
 
-                safe_cleanup(outputdir, progress_updater, m_logger);
+                {
+                    scoped_phase phase(m_phase_timer, execution_phase::cleanup);
+                    safe_cleanup(m_output_pool, outputdir, progress_updater, m_logger);
+                }
 
                 kernel_res["status"] = "error";
                 kernel_res["ename"] = error.m_ename;
                 kernel_res["evalue"] = error.m_evalue;
                 kernel_res["traceback"] = error.m_traceback;
 
+                end_execution(kernel_res);
                 return kernel_res;
             }
         }
 
-        // Publish the latest test evaluation
-        py::object last_test_evaluation = m_return_value_listener.attr("get_last_value")();
+        // Publish the latest test evaluation, the listener did not see the tasks
+        // of parallel executions and still holds the value of an earlier cell
+        py::object last_test_evaluation = parallel ? py::none() : m_return_value_listener.attr("get_last_value")();
         if (!last_test_evaluation.is_none())
         {
             display.attr("display")(last_test_evaluation, "raw"_a=true);
         }
+        publish_phase.stop();
 
-        safe_cleanup(outputdir, progress_updater, m_logger);
+        {
+            scoped_phase phase(m_phase_timer, execution_phase::cleanup);
+            safe_cleanup(m_output_pool, outputdir, progress_updater, m_logger);
+        }
 
         kernel_res["status"] = "ok";
         kernel_res["user_expressions"] = nl::json::object();
         kernel_res["payload"] = nl::json::array();
 
+        end_execution(kernel_res);
         return kernel_res;
     }
 
+    void interpreter::record_run_phase(phase_timer::clock_type::time_point start)
+    {
+        // Parsing and report generation happen within the robot execution
+        phase_timer::duration_type elapsed = phase_timer::clock_type::now() - start;
+        elapsed -= m_phase_timer.get(execution_phase::parse) + m_phase_timer.get(execution_phase::report);
+        m_phase_timer.add(execution_phase::run, std::max(elapsed, phase_timer::duration_type::zero()));
+    }
+
+    void interpreter::end_execution(nl::json& kernel_res)
+    {
+        m_phase_histograms.record(m_phase_timer);
+        kernel_res["timings"] = m_phase_timer.to_json();
+
+        // The debugger warm-up waits for the end of the first execution, so that
+        // it does not compete with it for the GIL
+        if (m_debugger_warmup_enabled)
+        {
+            m_debugger_warmup.start();
+        }
+    }
+
+    py::object interpreter::build_report(const py::object& generate_report,
+                                         const py::args& args,
+                                         const py::kwargs& kwargs)
+    {
+        scoped_phase phase(m_phase_timer, execution_phase::report);
+
+        if (!m_lazy_report || m_outputdir.empty())
+        {
+            return generate_report(*args, **kwargs);
+        }
+
+        try
+        {
+            py::module os = py::module::import("os");
+            py::module shutil = py::module::import("shutil");
+
+            // Only the robot outputs are retained, the report is built again from
+            // output.xml and the suite of the run is not kept alive
+            if (!os.attr("path").attr("isfile")(os.attr("path").attr("join")(m_outputdir, "output.xml")).cast<bool>())
+            {
+                return generate_report(*args, **kwargs);
+            }
+
+            std::string directory = py::str(py::module::import("tempfile").attr("mkdtemp")("prefix"_a="xrobot_report_"));
+
+            // Move the robot outputs out of the recycled output directory
+            for (const py::handle& name : os.attr("listdir")(m_outputdir))
+            {
+                shutil.attr("move")(os.attr("path").attr("join")(m_outputdir, name), directory);
+            }
+
+            py::object build = get_embedded_scope(build_report_py)["build_report"];
+            py::object builder = py::module::import("functools").attr("partial")(build, generate_report, directory);
+
+            m_pending_report = m_report_store.retain(builder, directory);
+            return py::none();
+        }
+        catch (py::error_already_set& e)
+        {
+            m_logger.attr("warning")("Could not defer the report generation: " + std::string(e.what()));
+            return generate_report(*args, **kwargs);
+        }
+    }
+
+    void interpreter::publish_report_summary(int execution_count, const result_summary& summary, const std::string& handle)
+    {
+        std::stringstream text;
+        text << summary.total() << " task(s): " << summary.m_passed << " passed, "
+             << summary.m_failed << " failed, " << summary.m_skipped << " skipped";
+
+        std::stringstream html;
+        html << "<div class=\"xrobot-report-summary\" data-report-handle=\"" << handle << "\">"
+             << "<b>" << summary.total() << " task(s)</b>: "
+             << "<span style=\"color: green\">" << summary.m_passed << " passed</span>, "
+             << "<span style=\"color: red\">" << summary.m_failed << " failed</span>, "
+             << summary.m_skipped << " skipped"
+             << "</div>";
+
+        nl::json data = {
+            {"text/plain", text.str()},
+            {"text/html", html.str()}
+        };
+        nl::json metadata = {
+            {"xrobot_report", {
+                {"handle", handle},
+                {"comm_target", "xrobot.report"}
+            }}
+        };
+        publish_execution_result(execution_count, std::move(data), std::move(metadata));
+    }
+
+    void interpreter::handle_report_message(const xeus::xguid& id, const xeus::xmessage& message)
+    {
+        nl::json data = message.content().value("data", nl::json::object());
+        std::string action = data.value("action", "");
+
+        nl::json reply = {{"action", action}};
+        if (action == "render")
+        {
+            std::string handle = data.value("handle", "");
+            reply["handle"] = handle;
+
+            py::gil_scoped_acquire acquire;
+            try
+            {
+                py::object report = m_report_store.build(handle);
+                reply["data"] = report.is_none() ? nl::json() : nl::json(report);
+            }
+            catch (py::error_already_set& e)
+            {
+                reply["error"] = e.what();
+            }
+            // The report may hold values that do not convert to JSON
+            catch (std::exception& e)
+            {
+                reply["error"] = std::string("Could not convert the report: ") + e.what();
+            }
+        }
+        else if (action == "configure")
+        {
+            m_lazy_report = data.value("lazy", m_lazy_report);
+            reply["lazy"] = m_lazy_report;
+        }
+        else
+        {
+            reply["error"] = "Unknown action: " + action;
+        }
+
+        auto it = m_report_comms.find(id);
+        if (it != m_report_comms.end())
+        {
+            it->second.send(nl::json::object(), std::move(reply), xeus::buffer_sequence());
+        }
+    }
+
+    void interpreter::handle_trace_message(const xeus::xguid& id, const xeus::xmessage& message)
+    {
+        nl::json data = message.content().value("data", nl::json::object());
+        std::string action = data.value("action", "");
+
+        nl::json reply = {{"action", action}};
+        if (action == "dump")
+        {
+            reply["trace"] = dump_trace();
+        }
+        else if (action == "configure")
+        {
+            set_trace_enabled(data.value("enabled", is_trace_enabled()));
+            reply["enabled"] = is_trace_enabled();
+        }
+        else
+        {
+            reply["error"] = "Unknown action: " + action;
+        }
+
+        auto it = m_trace_comms.find(id);
+        if (it != m_trace_comms.end())
+        {
+            it->second.send(nl::json::object(), std::move(reply), xeus::buffer_sequence());
+        }
+    }
+
+    void interpreter::erase_closed_comms()
+    {
+        for (const xeus::xguid& id : m_closed_comms)
+        {
+            m_report_comms.erase(id);
+            m_trace_comms.erase(id);
+        }
+        m_closed_comms.clear();
+    }
+
     nl::json interpreter::execute_python(
         const std::string& code,
         py::object modulename,
@@ -281,19 +695,7 @@ namespace xrob
     {
         nl::json kernel_res;
 
-        py::module sys = py::module::import("sys");
-        py::module types = py::module::import("types");
-        py::module linecache = py::module::import("linecache");
-        py::module builtins = py::module::import("builtins");
-        py::module display = py::module::import("IPython.display");
-
-        // Create Python module
-        py::object module = types.attr("ModuleType")(modulename);
-
-        sys.attr("modules")[modulename] = module;
-
-        // Caching the input code
-        linecache.attr("updatecache")(code, filename);
+        std::string name = modulename.cast<std::string>();
 
         // Reset traceback
         m_ipython_shell.attr("last_error") = py::none();
@@ -301,19 +703,38 @@ namespace xrob
         // Execute it
         try
         {
-            py::object compiled_code = builtins.attr("compile")(code, filename, "exec");
-
-            // Inject display in the scope
-            module.attr("__dict__")["display"] = display.attr("display");
+            // Identical sources are not compiled again
+            py::object compiled_code = m_module_registry.find(name, code);
+            if (compiled_code.is_none())
+            {
+                scoped_phase phase(m_phase_timer, execution_phase::parse);
+                // Caching the input code for the tracebacks, the cell file is never written
+                py::list lines = py::str(code).attr("splitlines")(true);
+                py::module::import("linecache").attr("cache")[py::str(filename)] = py::make_tuple(code.size(), py::none(), lines, filename);
+                compiled_code = py::module::import("builtins").attr("compile")(code, filename, "exec");
+            }
 
-            xpyt::exec(compiled_code, module.attr("__dict__"));
+            {
+                scoped_phase phase(m_phase_timer, execution_phase::run);
+                // Changed modules are executed in place. Library instances robot
+                // already holds keep the old definitions, the next import of the
+                // library creates instances of the new ones
+                exec_module(compiled_code, name);
+            }
 
             kernel_res["status"] = "ok";
             kernel_res["user_expressions"] = nl::json::object();
             kernel_res["payload"] = nl::json::array();
 
             // Keep the Python module name around for library completion
-            m_python_modules.attr("append")(modulename);
+            if (m_module_registry.insert(name, code, compiled_code))
+            {
+                m_python_modules.attr("append")(modulename);
+            }
+            m_session_definitions.add_python_module(name, code);
+            // The library is indexed again on its next import
+            m_keyword_index.remove_source(name);
+            ++m_suite_generation;
         }
         catch (py::error_already_set& e)
         {
@@ -328,6 +749,7 @@ namespace xrob
 
             if (!silent)
             {
+                scoped_phase phase(m_phase_timer, execution_phase::publish);
                 publish_execution_error(error.m_ename, error.m_evalue, error.m_traceback);
             }
 
@@ -344,22 +766,20 @@ namespace xrob
         const std::string& code,
         int cursor_pos)
     {
-        // Acquire GIL before executing code
-        py::gil_scoped_acquire acquire;
+        trace_span span("complete_request");
+
+        cell_info cell = classify_cell(code);
 
         // If it's Python code
-        py::module re = py::module::import("re");
-        py::object match = re.attr("match")(PYTHON_MODULE_REGEX, code);
-        if (!match.is_none())
+        if (cell.m_kind == cell_kind::python_module)
         {
-            py::object module_name = py::list(match.attr("groups")())[0];
+            // Acquire GIL before executing code
+            py::gil_scoped_acquire acquire;
 
-            // Extract Python code from the cell
-            std::string python_code = code;
-            int header_len = py::list(match.attr("span")())[1].cast<int>();
-            python_code.erase(0, header_len);
+            // The header is plain ASCII, its length is the same in bytes and in code points
+            int header_len = static_cast<int>(cell.m_header_length);
 
-            nl::json xpython_res = xpyt::interpreter::complete_request_impl(python_code, cursor_pos - header_len);
+            nl::json xpython_res = xpyt::interpreter::complete_request_impl(cell.m_body.str(), cursor_pos - header_len);
 
             // Fix cursor pos in xpython's answer
             xpython_res["cursor_start"] = xpython_res["cursor_start"].get<int>() + header_len;
@@ -368,6 +788,27 @@ namespace xrob
             return xpython_res;
         }
 
+        // Libraries imported by the last runs are documented before the key
+        // is computed, indexing them changes the suite generation
+        cursor_info cursor = classify_cursor(cell, code, cursor_pos);
+        if (cursor.m_context == cursor_context::keyword_call && m_keyword_index.has_pending_sources())
+        {
+            py::gil_scoped_acquire acquire;
+            index_pending_sources(m_keyword_index);
+        }
+
+        // Repeated requests are answered without the GIL
+        bool cacheable = is_cacheable(cursor.m_context);
+        std::string key = get_request_key(code, cursor, false, get_suite_generation());
+        const nl::json* cached = cacheable ? m_completion_cache.find(key) : nullptr;
+        if (cached != nullptr)
+        {
+            return *cached;
+        }
+
+        // Acquire GIL before executing code
+        py::gil_scoped_acquire acquire;
+
         py::module robot_interpreter = py::module::import("robotframework_interpreter");
 
         nl::json xrobot_res = robot_interpreter.attr("complete")(
@@ -375,45 +816,135 @@ namespace xrob
         );
         xrobot_res["status"] = "ok";
         xrobot_res["metadata"] = nl::json::object();
+
+        // Keyword calls are also completed from the native index, which
+        // knows the keywords of all the imported libraries and resources
+        if (cursor.m_context == cursor_context::keyword_call)
+        {
+            xrobot_res = merge_completions(complete_keyword(code, cursor), std::move(xrobot_res));
+        }
+
+        if (cacheable)
+        {
+            m_completion_cache.insert(key, xrobot_res);
+        }
         return xrobot_res;
     }
 
+    std::size_t interpreter::get_suite_generation() const
+    {
+        // Both counters only grow, their sum changes whenever one of them does
+        return m_suite_generation + m_keyword_index.generation();
+    }
+
+    void interpreter::bump_generation_on_imports()
+    {
+        // Imported libraries are only indexed by the next completion, inspection
+        // must not keep answering from results cached before the import
+        if (m_keyword_index.has_pending_sources())
+        {
+            ++m_suite_generation;
+        }
+    }
+
+    nl::json interpreter::complete_keyword(const std::string& code, const cursor_info& cursor)
+    {
+        nl::json matches = nl::json::array();
+        nl::json types = nl::json::array();
+
+        std::string prefix = code.substr(cursor.m_token_begin, cursor.m_offset - cursor.m_token_begin);
+        int cursor_start = offset_to_code_point(code, cursor.m_token_begin);
+        int cursor_end = offset_to_code_point(code, cursor.m_offset);
+
+        // Library qualified names and test settings are left to robotframework_interpreter
+        if (prefix.find('.') == std::string::npos && (prefix.empty() || prefix[0] != '['))
+        {
+            // BuiltIn is imported implicitly, without library_import event
+            if (!m_keyword_index.has_source("BuiltIn"))
+            {
+                index_library(m_keyword_index, "BuiltIn", "BuiltIn");
+            }
+
+            for (const keyword_entry* entry : m_keyword_index.complete(prefix, max_keyword_completions))
+            {
+                matches.push_back(entry->m_name);
+                types.push_back({
+                    {"start", cursor_start},
+                    {"end", cursor_end},
+                    {"text", entry->m_name},
+                    {"type", "keyword"}
+                });
+            }
+        }
+
+        nl::json reply;
+        reply["matches"] = std::move(matches);
+        reply["cursor_start"] = cursor_start;
+        reply["cursor_end"] = cursor_end;
+        reply["metadata"] = {{"_jupyter_types_experimental", std::move(types)}};
+        reply["status"] = "ok";
+        return reply;
+    }
+
     nl::json interpreter::inspect_request_impl(const std::string& code,
                                                int cursor_pos,
                                                int detail_level)
     {
-        // Acquire GIL before executing code
-        py::gil_scoped_acquire acquire;
+        trace_span span("inspect_request");
+
+        cell_info cell = classify_cell(code);
 
         // If it's Python code
-        py::module re = py::module::import("re");
-        py::object match = re.attr("match")(PYTHON_MODULE_REGEX, code);
-        if (!match.is_none())
+        if (cell.m_kind == cell_kind::python_module)
         {
-            py::object module_name = py::list(match.attr("groups")())[0];
+            // Acquire GIL before executing code
+            py::gil_scoped_acquire acquire;
 
-            // Extract Python code from the cell
-            std::string python_code = code;
-            int header_len = py::list(match.attr("span")())[1].cast<int>();
-            python_code.erase(0, header_len);
+            int header_len = static_cast<int>(cell.m_header_length);
 
-            nl::json xpython_res = xpyt::interpreter::inspect_request_impl(python_code, cursor_pos - header_len, detail_level);
+            nl::json xpython_res = xpyt::interpreter::inspect_request_impl(cell.m_body.str(), cursor_pos - header_len, detail_level);
 
             return xpython_res;
         }
 
+        // The documentation of a token is rendered once per suite generation
+        cursor_info cursor = classify_cursor(cell, code, cursor_pos);
+        bool cacheable = is_cacheable(cursor.m_context);
+        std::string key = get_request_key(code, cursor, true, get_suite_generation(), detail_level + 1);
+        const nl::json* cached = cacheable ? m_completion_cache.find(key) : nullptr;
+        if (cached != nullptr)
+        {
+            return *cached;
+        }
+
+        // Acquire GIL before executing code
+        py::gil_scoped_acquire acquire;
+
         py::module robot_interpreter = py::module::import("robotframework_interpreter");
 
         nl::json xrobot_res = robot_interpreter.attr("inspect")(
             code, cursor_pos, m_test_suite, m_keywords_listener, detail_level, "logger"_a=m_logger
         );
         xrobot_res["status"] = "ok";
+
+        if (cacheable)
+        {
+            m_completion_cache.insert(key, xrobot_res);
+        }
         return xrobot_res;
     }
 
-    nl::json interpreter::is_complete_request_impl(const std::string& /*code*/)
+    nl::json interpreter::is_complete_request_impl(const std::string& code)
     {
+        // Answered natively, without the GIL, console clients send it on every Enter
+        is_complete_result result = check_is_complete(code);
+
         nl::json kernel_res;
+        kernel_res["status"] = result.m_status;
+        if (result.m_status == "incomplete")
+        {
+            kernel_res["indent"] = result.m_indent;
+        }
         return kernel_res;
     }
 
@@ -455,6 +986,9 @@ namespace xrob
             {"url", "https://robotframework.org"}
         });
 
+        // Cumulative per-phase execution timings of the session
+        result["execution_timings"] = m_phase_histograms.to_json();
+
         result["status"] = "ok";
         return result;
     }
@@ -464,10 +998,47 @@ namespace xrob
         // Acquire GIL before executing code
         py::gil_scoped_acquire acquire;
 
-        py::module robot_interpreter = py::module::import("robotframework_interpreter");
+        // Hand the idle pooled sessions over to the next kernel or close them, then shutdown drivers
+        m_browser_pool.handover();
+        shutdown_drivers(m_drivers, m_shutdown_workers, m_driver_shutdown_timeout, m_shutdown_timeout, m_logger);
+
+        m_output_pool.stop();
+        m_progress_coalescer.stop();
+        m_report_store.clear();
 
-        // Shutdown drivers
-        robot_interpreter.attr("shutdown_drivers")(m_drivers);
+        std::string trace_file = get_env_string("XROBOT_TRACE", "");
+        if (is_trace_enabled() && !trace_file.empty() && !write_trace(trace_file))
+        {
+            m_logger.attr("warning")("Could not write the trace to " + trace_file);
+        }
+    }
+
+    py::object interpreter::parse_cell(const py::object& get_model,
+                                       const py::object& source,
+                                       const py::kwargs& kwargs)
+    {
+        scoped_phase phase(m_phase_timer, execution_phase::parse);
+
+        // Only the cell being executed is cached, its content hash is the key
+        if (m_parse_cache_key.empty())
+        {
+            return get_model(source, **kwargs);
+        }
+
+        // ${CURDIR} is resolved at parse time
+        std::string key = m_parse_cache_key;
+        if (kwargs.contains("curdir"))
+        {
+            key += ":" + std::string(py::str(kwargs["curdir"]));
+        }
+
+        const parsed_cell* cell = m_parse_cache.find(key);
+        if (cell == nullptr)
+        {
+            cell = &m_parse_cache.insert(key, parse_robot_cell(get_model, source, kwargs));
+        }
+        m_parsed_cell_key = key;
+        return cell->m_model;
     }
 
     nl::json interpreter::internal_request_impl(const nl::json& content)
@@ -482,28 +1053,31 @@ namespace xrob
 
         try
         {
-            try
-            {
-                m_listeners.attr("remove")(m_debug_listener);
-                m_listeners.attr("remove")(m_debug_listenerv2);
-            }
-            catch(py::error_already_set& e)
-            {
-                // Ignoring the exception if the element is not in the list
-            }
+            m_listener_multiplexer.remove(m_debug_listener);
+            m_listener_multiplexer.remove(m_debug_listenerv2);
 
-            py::dict scope;
+            // Reuses the modules and listeners of the debugger warm-up, waiting
+            // for it when it is still running
+            py::dict scope = m_debugger_warmup.take();
 
             xpyt::exec(py::str(code), scope);
 
-            m_debug_listener = scope["debug_listener"];
-            m_debug_listenerv2 = scope["debug_listenerv2"];
             m_debug_adapter = scope["processor"];
+            // The debug listeners only see the keywords the debugger may stop on
+            std::vector<py::object> gates = make_debug_gates({scope["debug_listener"], scope["debug_listenerv2"]},
+                                                             get_breakpoint_index(),
+                                                             m_debug_adapter);
+            m_debug_listener = gates[0];
+            m_debug_listenerv2 = gates[1];
 
-            m_listeners.append(m_debug_listener);
-            m_listeners.append(m_debug_listenerv2);
+            m_listener_multiplexer.add(m_debug_listener);
+            m_listener_multiplexer.add(m_debug_listenerv2);
 
             reply["status"] = "ok";
+            if (scope.contains("warmup_time"))
+            {
+                reply["warmup_time"] = scope["warmup_time"].cast<double>();
+            }
         }
         catch (py::error_already_set& e)
         {
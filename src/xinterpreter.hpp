@@ -16,12 +16,32 @@
     #pragma GCC diagnostic ignored "-Wattributes"
 #endif
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include "nlohmann/json.hpp"
 
+#include "xeus/xcomm.hpp"
+
 #include "xeus-python/xinterpreter.hpp"
 
+#include "xbrowser_pool.hpp"
+#include "xcell_classifier.hpp"
+#include "xcompletion_cache.hpp"
+#include "xdebugger_warmup.hpp"
+#include "xkeyword_index.hpp"
+#include "xlibrary_listeners.hpp"
+#include "xlistener_multiplexer.hpp"
+#include "xmodule_registry.hpp"
+#include "xoutput_pool.hpp"
+#include "xparallel.hpp"
+#include "xparse_cache.hpp"
+#include "xprogress_coalescer.hpp"
+#include "xreport_store.hpp"
+#include "xresult_summary.hpp"
+#include "xtimings.hpp"
+
 namespace nl = nlohmann;
 
 namespace xrob
@@ -47,6 +67,9 @@ namespace xrob
         nl::json execute_python(const std::string& code, py::object modulename, const std::string& filename, bool silent);
 
         nl::json complete_request_impl(const std::string& code, int cursor_pos) override;
+        nl::json complete_keyword(const std::string& code, const cursor_info& cursor);
+        std::size_t get_suite_generation() const;
+        void bump_generation_on_imports();
 
         nl::json inspect_request_impl(const std::string& code,
                                       int cursor_pos,
@@ -60,6 +83,17 @@ namespace xrob
 
         nl::json internal_request_impl(const nl::json& content) override;
 
+        py::object parse_cell(const py::object& get_model, const py::object& source, const py::kwargs& kwargs);
+
+        void record_run_phase(phase_timer::clock_type::time_point start);
+        void end_execution(nl::json& kernel_res);
+
+        py::object build_report(const py::object& generate_report, const py::args& args, const py::kwargs& kwargs);
+        void publish_report_summary(int execution_count, const result_summary& summary, const std::string& handle);
+        void handle_report_message(const xeus::xguid& id, const xeus::xmessage& message);
+        void handle_trace_message(const xeus::xguid& id, const xeus::xmessage& message);
+        void erase_closed_comms();
+
         py::object m_test_suite;
 
         py::object m_debug_listener;
@@ -67,12 +101,60 @@ namespace xrob
         py::object m_keywords_listener;
         py::object m_return_value_listener;
         py::object m_status_listener;
+        // Listeners passed directly to robot, the others go through the multiplexer
         py::list m_listeners;
+        listener_multiplexer m_listener_multiplexer;
 
         py::list m_drivers;
+        library_listeners m_library_listeners;
 
         py::list m_python_modules;
+        module_registry m_module_registry;
+        keyword_index m_keyword_index;
         py::object m_debug_adapter;
+
+        parse_cache m_parse_cache;
+        std::string m_parse_cache_key;
+        // Key the executed cell was parsed under, ${CURDIR} included
+        std::string m_parsed_cell_key;
+
+        output_pool m_output_pool;
+
+        phase_timer m_phase_timer;
+        phase_histograms m_phase_histograms;
+
+        bool m_lazy_report;
+        report_store m_report_store;
+        std::string m_outputdir;
+        std::string m_pending_report;
+        std::map<xeus::xguid, xeus::xcomm> m_report_comms;
+        std::map<xeus::xguid, xeus::xcomm> m_trace_comms;
+        // A comm cannot be destroyed from its own close handler, closed comms
+        // are erased when the next one opens
+        std::vector<xeus::xguid> m_closed_comms;
+
+        progress_coalescer m_progress_coalescer;
+
+        session_definitions m_session_definitions;
+        std::size_t m_parallel_workers;
+        // Seconds after which the worker processes are killed, 0 for no limit
+        std::size_t m_parallel_timeout;
+
+        // Bumped when cells define keywords or load Python modules, completion
+        // and inspect replies are cached per generation
+        completion_cache m_completion_cache;
+        std::size_t m_suite_generation;
+
+        browser_pool m_browser_pool;
+
+        // Drivers are closed concurrently, timeouts are in seconds
+        std::size_t m_shutdown_workers;
+        std::size_t m_driver_shutdown_timeout;
+        std::size_t m_shutdown_timeout;
+
+        // Pre-imports the debug adapter once the first execution is done
+        bool m_debugger_warmup_enabled;
+        debugger_warmup m_debugger_warmup;
     };
 }
 
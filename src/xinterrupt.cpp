@@ -0,0 +1,103 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <atomic>
+#include <csignal>
+
+#include "pybind11/pybind11.h"
+
+#include "xinternal_utils.hpp"
+#include "xinterrupt.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    namespace
+    {
+        // Set by the SIGINT handler, read by the parallel runs
+        std::atomic<bool> interrupt_requested(false);
+        std::atomic<bool> stop_requested(false);
+
+        const char* interrupt_py = R"py(
+import signal
+import threading
+
+previous_handler = None
+
+
+def install(handler):
+    # Signal handlers can only be set from the main thread
+    global previous_handler
+    if threading.current_thread() is threading.main_thread():
+        previous_handler = signal.signal(signal.SIGINT, handler)
+
+
+def restore():
+    global previous_handler
+    if previous_handler is not None:
+        signal.signal(signal.SIGINT, previous_handler)
+        previous_handler = None
+)py";
+
+        py::object get_stop_signal_monitor()
+        {
+            return py::module::import("robot.running.signalhandler").attr("STOP_SIGNAL_MONITOR");
+        }
+
+        void stop_robot_run()
+        {
+            // Same as robot receiving the first SIGINT: the next keyword to start
+            // fails with "Execution terminated by signal" and the run ends normally.
+            // A second call would force the exit of the process.
+            if (!stop_requested.exchange(true))
+            {
+                get_stop_signal_monitor()(SIGINT, py::none());
+            }
+        }
+    }
+
+    bool is_interrupt_requested()
+    {
+        return interrupt_requested;
+    }
+
+    void start_robot_run()
+    {
+        interrupt_requested = false;
+        stop_requested = false;
+
+        // Robot counts the received signals for the lifetime of the process, a
+        // run following an interrupted one would stop at its first keyword.
+        // The monitor is reset through its constructor.
+        py::object monitor = get_stop_signal_monitor();
+        monitor.attr("__init__")();
+
+        // Robot replaces this handler with its own while it runs in the kernel
+        // process and restores it afterwards, so it only sees the interruptions
+        // outside of robot: parallel runs and the preparation of the run
+        get_embedded_scope(interrupt_py)["install"](py::cpp_function([](py::object, py::object)
+        {
+            if (interrupt_requested.exchange(true))
+            {
+                PyErr_SetNone(PyExc_KeyboardInterrupt);
+                throw py::error_already_set();
+            }
+            stop_robot_run();
+        }));
+    }
+
+    void end_robot_run()
+    {
+        get_embedded_scope(interrupt_py)["restore"]();
+        interrupt_requested = false;
+        stop_requested = false;
+    }
+}
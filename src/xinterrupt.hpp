@@ -0,0 +1,38 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_INTERRUPT_HPP
+#define XROB_INTERRUPT_HPP
+
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    // Whether an interruption was received during the current run
+    bool is_interrupt_requested();
+
+    /**
+     * Installs the SIGINT handler of the kernel for the duration of a robot
+     * run and restores the previous one. The first interruption stops the
+     * run at the next keyword through robot's own stop signal handler: the
+     * current task fails and the remaining ones are not run. A second one
+     * raises KeyboardInterrupt in the running Python code.
+     *
+     * Robot installs its handler for the duration of the runs it executes
+     * in the main thread. Outside of the runs, interruptions are left to
+     * the previous handler. Must be called with the GIL held.
+     */
+    void start_robot_run();
+    void end_robot_run();
+}
+
+#endif
@@ -0,0 +1,244 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "xcell_classifier.hpp"
+#include "xis_complete.hpp"
+#include "xtokenizer.hpp"
+
+namespace xrob
+{
+    namespace
+    {
+        const std::string indent_unit = "    ";
+
+        bool is_blank(const std::string& line)
+        {
+            return line.find_first_not_of(" \t\r") == std::string::npos;
+        }
+
+        std::vector<std::string> split_lines(const std::string& code)
+        {
+            std::vector<std::string> lines;
+            std::size_t pos = 0;
+            while (true)
+            {
+                std::size_t end = code.find('\n', pos);
+                if (end == std::string::npos)
+                {
+                    lines.push_back(code.substr(pos));
+                    return lines;
+                }
+                lines.push_back(code.substr(pos, end - pos));
+                pos = end + 1;
+            }
+        }
+
+        bool is_body_section(section_kind section)
+        {
+            return section == section_kind::test_cases || section == section_kind::tasks ||
+                   section == section_kind::keywords;
+        }
+
+        is_complete_result check_robot(const std::string& code)
+        {
+            std::vector<std::string> lines = split_lines(code);
+
+            line_state state;
+            bool has_body_section = false;
+            // Indentation of the open blocks
+            std::vector<std::string> blocks;
+            std::string last_indent;
+            bool last_is_name = false;
+            bool last_is_continuation = false;
+            std::vector<token> tokens;
+
+            for (const std::string& line : lines)
+            {
+                std::size_t block_depth = state.m_block_depth;
+                tokens.clear();
+                tokenize_line(line.data(), line.size(), 0, 0, state, tokens);
+                if (tokens.empty())
+                {
+                    continue;
+                }
+
+                const token& first = tokens.front();
+                if (first.m_kind == token_kind::header)
+                {
+                    has_body_section = has_body_section || is_body_section(state.m_section);
+                    blocks.clear();
+                    last_indent.clear();
+                    last_is_name = false;
+                    last_is_continuation = false;
+                    continue;
+                }
+
+                // Comment lines, and the lines of comment sections
+                if (first.m_kind == token_kind::comment)
+                {
+                    continue;
+                }
+
+                // A non indented line starts a new test, task or keyword
+                last_is_name = first.m_kind == token_kind::name;
+                if (last_is_name)
+                {
+                    blocks.clear();
+                }
+
+                last_is_continuation = first.m_kind == token_kind::continuation;
+                last_indent = line.substr(0, first.m_offset);
+
+                bool in_body = is_body_section(state.m_section) || state.m_section == section_kind::none;
+                if (!in_body || last_is_continuation)
+                {
+                    continue;
+                }
+
+                if (state.m_block_depth > block_depth)
+                {
+                    blocks.push_back(last_indent);
+                }
+                else if (first.m_kind == token_kind::control && line.compare(first.m_offset, first.m_length, "END") == 0)
+                {
+                    if (blocks.empty())
+                    {
+                        return {"invalid", ""};
+                    }
+                    blocks.pop_back();
+                }
+            }
+
+            if (!blocks.empty())
+            {
+                return {"incomplete", blocks.back() + indent_unit};
+            }
+
+            // Otherwise, a trailing blank line submits the cell
+            bool ends_with_blank_line = lines.size() > 1 && is_blank(lines.back());
+            if (ends_with_blank_line)
+            {
+                return {"complete", ""};
+            }
+            if (last_is_continuation)
+            {
+                return {"incomplete", last_indent};
+            }
+            if (has_body_section)
+            {
+                return {"incomplete", last_is_name ? indent_unit : last_indent};
+            }
+            return {"complete", ""};
+        }
+
+        is_complete_result check_python(const std::string& body)
+        {
+            std::vector<std::string> lines = split_lines(body);
+
+            int brackets = 0;
+            char quote = 0;
+            bool triple = false;
+            std::string last_line;
+            for (const std::string& line : lines)
+            {
+                for (std::size_t i = 0; i < line.size(); ++i)
+                {
+                    char c = line[i];
+                    if (quote != 0)
+                    {
+                        if (c == '\\')
+                        {
+                            ++i;
+                        }
+                        else if (c == quote && (!triple || line.compare(i, 3, std::string(3, quote)) == 0))
+                        {
+                            i += triple ? 2 : 0;
+                            quote = 0;
+                        }
+                    }
+                    else if (c == '#')
+                    {
+                        break;
+                    }
+                    else if (c == '\'' || c == '"')
+                    {
+                        quote = c;
+                        triple = line.compare(i, 3, std::string(3, c)) == 0;
+                        i += triple ? 2 : 0;
+                    }
+                    else if (c == '(' || c == '[' || c == '{')
+                    {
+                        ++brackets;
+                    }
+                    else if (c == ')' || c == ']' || c == '}')
+                    {
+                        --brackets;
+                    }
+                }
+
+                // Single quoted strings do not span lines
+                if (quote != 0 && !triple)
+                {
+                    quote = 0;
+                }
+                if (!is_blank(line))
+                {
+                    last_line = line;
+                }
+            }
+
+            if (brackets < 0)
+            {
+                return {"invalid", ""};
+            }
+
+            std::string indent = last_line.substr(0, last_line.find_first_not_of(" \t"));
+            if (quote != 0 || brackets > 0)
+            {
+                return {"incomplete", indent};
+            }
+
+            bool ends_with_blank_line = lines.size() > 1 && is_blank(lines.back());
+            std::size_t last = last_line.find_last_not_of(" \t\r");
+            if (last == std::string::npos)
+            {
+                return {"incomplete", ""};
+            }
+            if (last_line[last] == ':' && !ends_with_blank_line)
+            {
+                return {"incomplete", indent + indent_unit};
+            }
+            if (last_line[last] == '\\')
+            {
+                return {"incomplete", indent};
+            }
+            // Indented blocks are closed by a blank line, like in IPython
+            if (!indent.empty() && !ends_with_blank_line)
+            {
+                return {"incomplete", indent};
+            }
+            return {"complete", ""};
+        }
+    }
+
+    is_complete_result check_is_complete(const std::string& code)
+    {
+        cell_info cell = classify_cell(code);
+        if (cell.m_kind == cell_kind::python_module)
+        {
+            return check_python(cell.m_body.str());
+        }
+        return check_robot(code);
+    }
+}
@@ -0,0 +1,39 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_IS_COMPLETE_HPP
+#define XROB_IS_COMPLETE_HPP
+
+#include <string>
+
+namespace xrob
+{
+    struct is_complete_result
+    {
+        // "complete", "incomplete" or "invalid"
+        std::string m_status;
+        // Indentation of the next line, only meaningful for incomplete code
+        std::string m_indent;
+    };
+
+    /**
+     * Tells whether a cell can be submitted, for console clients. It does
+     * not require the GIL.
+     *
+     * Robot cells are incomplete while a FOR, WHILE, IF or TRY block is not
+     * closed by END, after a continuation line, and, when they have a
+     * test, task or keyword section, until they end with a blank line.
+     * %%python module bodies are incomplete while brackets or triple
+     * quoted strings are open, or after a line ending with ':' or '\'.
+     */
+    is_complete_result check_is_complete(const std::string& code);
+}
+
+#endif
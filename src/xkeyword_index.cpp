@@ -0,0 +1,337 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "xkeyword_index.hpp"
+
+namespace xrob
+{
+    namespace
+    {
+        // Minimum ratio of the query trigrams found in a fuzzy match
+        constexpr double min_fuzzy_score = 0.5;
+
+        std::uint32_t trigram(const std::string& key, std::size_t i)
+        {
+            return (static_cast<std::uint32_t>(static_cast<unsigned char>(key[i])) << 16)
+                 | (static_cast<std::uint32_t>(static_cast<unsigned char>(key[i + 1])) << 8)
+                 | static_cast<std::uint32_t>(static_cast<unsigned char>(key[i + 2]));
+        }
+
+        std::vector<std::uint32_t> get_trigrams(const std::string& key)
+        {
+            std::vector<std::uint32_t> res;
+            for (std::size_t i = 0; i + 3 <= key.size(); ++i)
+            {
+                res.push_back(trigram(key, i));
+            }
+            std::sort(res.begin(), res.end());
+            res.erase(std::unique(res.begin(), res.end()), res.end());
+            return res;
+        }
+    }
+
+    std::string normalize_keyword(const std::string& name)
+    {
+        std::string res;
+        res.reserve(name.size());
+        for (char c : name)
+        {
+            if (c != ' ' && c != '_')
+            {
+                res.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+            }
+        }
+        return res;
+    }
+
+    keyword_index::keyword_index()
+        : m_nodes(1)
+        , m_removed_count(0)
+        , m_generation(0)
+    {
+    }
+
+    bool keyword_index::has_source(const std::string& source) const
+    {
+        return m_sources.find(source) != m_sources.end();
+    }
+
+    void keyword_index::add_keywords(const std::string& source, const std::vector<std::string>& names)
+    {
+        auto source_it = m_sources.find(source);
+        if (source_it == m_sources.end())
+        {
+            source_it = m_sources.emplace(source, std::vector<std::uint32_t>()).first;
+            ++m_generation;
+        }
+        std::vector<std::uint32_t>& ids = source_it->second;
+
+        std::unordered_set<std::string> known;
+        for (std::uint32_t id : ids)
+        {
+            known.insert(normalize_keyword(m_entries[id].m_name));
+        }
+
+        for (const std::string& name : names)
+        {
+            if (known.insert(normalize_keyword(name)).second)
+            {
+                std::uint32_t id = static_cast<std::uint32_t>(m_entries.size());
+                m_entries.push_back({name, source, false});
+                ids.push_back(id);
+                insert(id);
+                ++m_generation;
+            }
+        }
+    }
+
+    void keyword_index::remove_source(const std::string& source)
+    {
+        m_pending_sources.erase(source);
+        auto it = m_sources.find(source);
+        if (it == m_sources.end())
+        {
+            return;
+        }
+
+        for (std::uint32_t id : it->second)
+        {
+            m_entries[id].m_removed = true;
+        }
+        m_removed_count += it->second.size();
+        m_sources.erase(it);
+        ++m_generation;
+
+        if (m_removed_count * 2 > m_entries.size())
+        {
+            rebuild();
+        }
+    }
+
+    void keyword_index::clear()
+    {
+        m_entries.clear();
+        m_nodes.assign(1, trie_node());
+        m_trigrams.clear();
+        m_sources.clear();
+        m_pending_sources.clear();
+        m_removed_count = 0;
+        ++m_generation;
+    }
+
+    void keyword_index::add_pending_source(const std::string& source, const std::string& spec)
+    {
+        if (!has_source(source))
+        {
+            m_pending_sources.emplace(source, spec);
+        }
+    }
+
+    bool keyword_index::has_pending_sources() const
+    {
+        return !m_pending_sources.empty();
+    }
+
+    std::map<std::string, std::string> keyword_index::take_pending_sources()
+    {
+        std::map<std::string, std::string> res;
+        res.swap(m_pending_sources);
+        return res;
+    }
+
+    std::vector<const keyword_entry*> keyword_index::complete(const std::string& prefix, std::size_t max_results) const
+    {
+        std::string key = normalize_keyword(prefix);
+
+        std::uint32_t node = 0;
+        for (char c : key)
+        {
+            const auto& children = m_nodes[node].m_children;
+            auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, std::uint32_t(0)));
+            if (it == children.end() || it->first != c)
+            {
+                node = std::uint32_t(-1);
+                break;
+            }
+            node = it->second;
+        }
+
+        std::vector<std::uint32_t> ids;
+        if (node != std::uint32_t(-1))
+        {
+            collect(node, ids);
+            std::sort(ids.begin(), ids.end(), [this](std::uint32_t lhs, std::uint32_t rhs)
+            {
+                return m_entries[lhs].m_name < m_entries[rhs].m_name;
+            });
+        }
+
+        if (ids.size() < max_results)
+        {
+            std::unordered_set<std::uint32_t> found(ids.begin(), ids.end());
+            for (std::uint32_t id : fuzzy_match(key, max_results))
+            {
+                if (found.find(id) == found.end())
+                {
+                    ids.push_back(id);
+                }
+            }
+        }
+
+        std::vector<const keyword_entry*> res;
+        for (std::uint32_t id : ids)
+        {
+            if (res.size() == max_results)
+            {
+                break;
+            }
+            res.push_back(&m_entries[id]);
+        }
+        return res;
+    }
+
+    std::size_t keyword_index::size() const
+    {
+        return m_entries.size() - m_removed_count;
+    }
+
+    std::size_t keyword_index::generation() const
+    {
+        return m_generation;
+    }
+
+    void keyword_index::insert(std::uint32_t id)
+    {
+        std::string key = normalize_keyword(m_entries[id].m_name);
+
+        std::uint32_t node = 0;
+        for (char c : key)
+        {
+            auto& children = m_nodes[node].m_children;
+            auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, std::uint32_t(0)));
+            if (it == children.end() || it->first != c)
+            {
+                std::uint32_t child = static_cast<std::uint32_t>(m_nodes.size());
+                // children is invalidated by the growth of m_nodes
+                children.insert(it, std::make_pair(c, child));
+                m_nodes.emplace_back();
+                node = child;
+            }
+            else
+            {
+                node = it->second;
+            }
+        }
+        m_nodes[node].m_entries.push_back(id);
+
+        for (std::uint32_t tri : get_trigrams(key))
+        {
+            m_trigrams[tri].push_back(id);
+        }
+    }
+
+    void keyword_index::rebuild()
+    {
+        std::vector<keyword_entry> entries;
+        entries.reserve(m_entries.size() - m_removed_count);
+        for (keyword_entry& entry : m_entries)
+        {
+            if (!entry.m_removed)
+            {
+                entries.push_back(std::move(entry));
+            }
+        }
+
+        // Pending sources are not indexed yet, compaction must not forget them
+        std::map<std::string, std::string> pending_sources = std::move(m_pending_sources);
+        clear();
+        m_pending_sources = std::move(pending_sources);
+        m_entries = std::move(entries);
+        for (std::uint32_t id = 0; id < m_entries.size(); ++id)
+        {
+            m_sources[m_entries[id].m_source].push_back(id);
+            insert(id);
+        }
+    }
+
+    void keyword_index::collect(std::uint32_t node, std::vector<std::uint32_t>& ids) const
+    {
+        for (std::uint32_t id : m_nodes[node].m_entries)
+        {
+            if (!m_entries[id].m_removed)
+            {
+                ids.push_back(id);
+            }
+        }
+        for (const auto& child : m_nodes[node].m_children)
+        {
+            collect(child.second, ids);
+        }
+    }
+
+    std::vector<std::uint32_t> keyword_index::fuzzy_match(const std::string& key, std::size_t max_results) const
+    {
+        std::vector<std::uint32_t> query = get_trigrams(key);
+        if (query.empty())
+        {
+            return {};
+        }
+
+        std::unordered_map<std::uint32_t, std::size_t> hits;
+        for (std::uint32_t tri : query)
+        {
+            auto it = m_trigrams.find(tri);
+            if (it != m_trigrams.end())
+            {
+                for (std::uint32_t id : it->second)
+                {
+                    ++hits[id];
+                }
+            }
+        }
+
+        std::vector<std::pair<std::size_t, std::uint32_t>> scored;
+        std::size_t min_hits = static_cast<std::size_t>(query.size() * min_fuzzy_score + 0.5);
+        for (const auto& hit : hits)
+        {
+            if (hit.second >= std::max(min_hits, std::size_t(1)) && !m_entries[hit.first].m_removed)
+            {
+                scored.emplace_back(hit.second, hit.first);
+            }
+        }
+
+        std::sort(scored.begin(), scored.end(), [this](const std::pair<std::size_t, std::uint32_t>& lhs,
+                                                       const std::pair<std::size_t, std::uint32_t>& rhs)
+        {
+            if (lhs.first != rhs.first)
+            {
+                return lhs.first > rhs.first;
+            }
+            return m_entries[lhs.second].m_name < m_entries[rhs.second].m_name;
+        });
+
+        std::vector<std::uint32_t> res;
+        for (std::size_t i = 0; i < scored.size() && i < max_results; ++i)
+        {
+            res.push_back(scored[i].second);
+        }
+        return res;
+    }
+}
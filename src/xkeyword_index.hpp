@@ -0,0 +1,99 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_KEYWORD_INDEX_HPP
+#define XROB_KEYWORD_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace xrob
+{
+    struct keyword_entry
+    {
+        std::string m_name;
+        // Library, resource or cell defining the keyword
+        std::string m_source;
+        bool m_removed = false;
+    };
+
+    /**
+     * Index of the keyword names known to the session, for completion.
+     * Names are normalized the way robot matches them (case, spaces and
+     * underscores are ignored). A trie answers prefix queries, a trigram
+     * index answers fuzzy queries.
+     *
+     * Keywords are added per source. Removed sources are tombstoned and
+     * the index is compacted once half of the entries are removed.
+     *
+     * Sources imported during a run are only recorded as pending, with the
+     * specification needed to document them, and are indexed on the next
+     * completion, out of the run.
+     */
+    class keyword_index
+    {
+    public:
+
+        keyword_index();
+
+        bool has_source(const std::string& source) const;
+
+        // Adds the keywords not already defined by this source
+        void add_keywords(const std::string& source, const std::vector<std::string>& names);
+        void remove_source(const std::string& source);
+        void clear();
+
+        // Ignored when the source is already indexed or pending
+        void add_pending_source(const std::string& source, const std::string& spec);
+        bool has_pending_sources() const;
+        // Returns the pending sources and their specifications, and forgets them
+        std::map<std::string, std::string> take_pending_sources();
+
+        // Prefix matches sorted by name, followed by fuzzy matches sorted by score
+        std::vector<const keyword_entry*> complete(const std::string& prefix, std::size_t max_results) const;
+
+        std::size_t size() const;
+
+        // Incremented each time the set of indexed keywords changes
+        std::size_t generation() const;
+
+    private:
+
+        struct trie_node
+        {
+            std::vector<std::pair<char, std::uint32_t>> m_children;
+            std::vector<std::uint32_t> m_entries;
+        };
+
+        void insert(std::uint32_t id);
+        void rebuild();
+
+        void collect(std::uint32_t node, std::vector<std::uint32_t>& ids) const;
+        std::vector<std::uint32_t> fuzzy_match(const std::string& key, std::size_t max_results) const;
+
+        std::vector<keyword_entry> m_entries;
+        std::vector<trie_node> m_nodes;
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> m_trigrams;
+        std::unordered_map<std::string, std::vector<std::uint32_t>> m_sources;
+        std::map<std::string, std::string> m_pending_sources;
+        std::size_t m_removed_count;
+        std::size_t m_generation;
+    };
+
+    // Lower case name without spaces nor underscores
+    std::string normalize_keyword(const std::string& name);
+}
+
+#endif
@@ -0,0 +1,74 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <string>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+#include "xkeyword_indexer.hpp"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace xrob
+{
+    py::object make_keyword_indexer(keyword_index& index)
+    {
+        py::object namespace_cls = py::module::import("types").attr("SimpleNamespace");
+        return namespace_cls(
+            "ROBOT_LISTENER_API_VERSION"_a=2,
+            "library_import"_a=py::cpp_function([&index](const py::object& name, const py::dict& attributes)
+            {
+                std::string library = py::str(attributes.contains("originalname") ? py::object(attributes["originalname"]) : name);
+                std::string spec = library;
+                if (attributes.contains("args"))
+                {
+                    for (const py::handle& arg : attributes["args"])
+                    {
+                        spec += "::" + std::string(py::str(arg));
+                    }
+                }
+                index.add_pending_source(library, spec);
+            }),
+            "resource_import"_a=py::cpp_function([&index](const py::object& /*name*/, const py::dict& attributes)
+            {
+                std::string source = py::str(attributes["source"]);
+                index.add_pending_source(source, source);
+            })
+        );
+    }
+
+    void index_library(keyword_index& index, const std::string& source, const std::string& spec)
+    {
+        std::vector<std::string> names;
+        try
+        {
+            py::object libdoc = py::module::import("robot.libdocpkg").attr("LibraryDocumentation");
+            for (const py::handle& keyword : libdoc(spec).attr("keywords"))
+            {
+                names.push_back(py::str(keyword.attr("name")));
+            }
+        }
+        catch (py::error_already_set&)
+        {
+            // Completion falls back to robotframework_interpreter for this source
+        }
+        index.add_keywords(source, names);
+    }
+
+    void index_pending_sources(keyword_index& index)
+    {
+        for (const auto& source : index.take_pending_sources())
+        {
+            index_library(index, source.first, source.second);
+        }
+    }
+}
@@ -0,0 +1,43 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_KEYWORD_INDEXER_HPP
+#define XROB_KEYWORD_INDEXER_HPP
+
+#include <string>
+
+#include "pybind11/pybind11.h"
+
+#include "xkeyword_index.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Robot listener recording the imported libraries and resources as
+     * pending sources of the index. Documenting a library imports it again
+     * and may take seconds, this is left to index_pending_sources.
+     */
+    py::object make_keyword_indexer(keyword_index& index);
+
+    /**
+     * Adds the keywords of a library or resource to the index using libdoc,
+     * spec is the libdoc argument (name, path, or name::arg1::arg2). Sources
+     * which cannot be documented are recorded without keywords so that they
+     * are not retried. The GIL must be held.
+     */
+    void index_library(keyword_index& index, const std::string& source, const std::string& spec);
+
+    // Indexes the pending sources of the index. The GIL must be held.
+    void index_pending_sources(keyword_index& index);
+}
+
+#endif
@@ -0,0 +1,67 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <string>
+#include <utility>
+
+#include "pybind11/pybind11.h"
+
+#include "xlibrary_listeners.hpp"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace xrob
+{
+    library_listeners::library_listeners()
+        : m_connection_listeners({
+            {"SeleniumLibrary", "SeleniumConnectionsListener", false},
+            {"Browser", "PlaywrightConnectionsListener", false},
+            {"JupyterLibrary", "JupyterConnectionsListener", false},
+            {"AppiumLibrary", "AppiumConnectionsListener", false},
+            {"WhiteLibrary", "WhiteLibraryListener", false}
+        })
+    {
+    }
+
+    py::object library_listeners::make_hook(listener_multiplexer& multiplexer, py::list drivers)
+    {
+        p_multiplexer = &multiplexer;
+        m_drivers = std::move(drivers);
+
+        py::object namespace_cls = py::module::import("types").attr("SimpleNamespace");
+        return namespace_cls(
+            "ROBOT_LISTENER_API_VERSION"_a=2,
+            "library_import"_a=py::cpp_function([this](const py::object& name, const py::dict& attributes)
+            {
+                // The name is the alias when the library is imported WITH NAME
+                py::object library = attributes.contains("originalname") ? py::object(attributes["originalname"]) : name;
+                library_import(py::str(library));
+            }),
+            // Keeps end_suite subscribed, listeners activated during a run are
+            // called on it
+            "end_suite"_a=py::cpp_function([](py::args) {})
+        );
+    }
+
+    void library_listeners::library_import(const std::string& library)
+    {
+        for (connection_listener& listener : m_connection_listeners)
+        {
+            if (!listener.m_active && library == listener.m_library)
+            {
+                listener.m_active = true;
+                py::module robot_interpreter = py::module::import("robotframework_interpreter");
+                py::object instance = robot_interpreter.attr(listener.m_listener)(m_drivers);
+                p_multiplexer->add(instance);
+            }
+        }
+    }
+}
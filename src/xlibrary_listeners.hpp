@@ -0,0 +1,63 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_LIBRARY_LISTENERS_HPP
+#define XROB_LIBRARY_LISTENERS_HPP
+
+#include <string>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+#include "xlistener_multiplexer.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Attaches the connection listener of a library (SeleniumLibrary, Browser,
+     * ...) to the robot listeners the first time the library is imported, so
+     * that sessions not using these libraries do not pay for them.
+     *
+     * A listener activated during a run gets the remaining events of that run
+     * through the multiplexer, in particular the end_suite event where the
+     * drivers are recorded.
+     *
+     * All the methods must be called with the GIL held.
+     */
+    class library_listeners
+    {
+    public:
+
+        library_listeners();
+
+        // Returns the robot listener reacting to the library imports
+        py::object make_hook(listener_multiplexer& multiplexer, py::list drivers);
+
+    private:
+
+        struct connection_listener
+        {
+            const char* m_library;
+            const char* m_listener;
+            bool m_active;
+        };
+
+        void library_import(const std::string& library);
+
+        std::vector<connection_listener> m_connection_listeners;
+
+        listener_multiplexer* p_multiplexer = nullptr;
+        py::list m_drivers;
+    };
+}
+
+#endif
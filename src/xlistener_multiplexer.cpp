@@ -0,0 +1,131 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+#include "xlistener_multiplexer.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    namespace
+    {
+        const char* listener_events[] = {
+            "start_suite", "end_suite", "start_test", "end_test",
+            "start_keyword", "end_keyword", "log_message", "message",
+            "library_import", "resource_import", "variables_import",
+            "output_file", "log_file", "report_file", "debug_file", "xunit_file",
+            "close"
+        };
+
+        std::size_t get_version_index(const py::object& listener)
+        {
+            py::object version = py::getattr(listener, "ROBOT_LISTENER_API_VERSION", py::int_(2));
+            return py::str(version).cast<std::string>() == "3" ? 1 : 0;
+        }
+    }
+
+    void listener_multiplexer::add(const py::object& listener)
+    {
+        subscriber_map& subscribers = m_subscribers[get_version_index(listener)];
+        for (const char* event : listener_events)
+        {
+            py::object method = py::getattr(listener, event, py::none());
+            if (!method.is_none() && PyCallable_Check(method.ptr()))
+            {
+                subscribers[event].push_back({listener, method});
+            }
+        }
+    }
+
+    void listener_multiplexer::remove(const py::object& listener)
+    {
+        for (subscriber_map& subscribers : m_subscribers)
+        {
+            for (auto& entry : subscribers)
+            {
+                std::vector<subscriber>& list = entry.second;
+                for (auto it = list.begin(); it != list.end();)
+                {
+                    it = it->m_listener.is(listener) ? list.erase(it) : it + 1;
+                }
+            }
+        }
+    }
+
+    py::list listener_multiplexer::make_listeners(const py::list& direct_listeners)
+    {
+        py::object namespace_cls = py::module::import("types").attr("SimpleNamespace");
+        py::list listeners;
+        for (const py::handle& listener : direct_listeners)
+        {
+            listeners.append(listener);
+        }
+
+        for (std::size_t index = 0; index < 2; ++index)
+        {
+            py::dict methods;
+            for (const auto& entry : m_subscribers[index])
+            {
+                if (!entry.second.empty())
+                {
+                    std::string event = entry.first;
+                    methods[event.c_str()] = py::cpp_function([this, index, event](py::args args)
+                    {
+                        dispatch(index, event, args);
+                    });
+                }
+            }
+
+            if (py::len(methods) != 0)
+            {
+                methods["ROBOT_LISTENER_API_VERSION"] = py::int_(index + 2);
+                listeners.append(namespace_cls(**methods));
+            }
+        }
+
+        return listeners;
+    }
+
+    void listener_multiplexer::dispatch(std::size_t version_index, const std::string& event, const py::args& args)
+    {
+        const std::vector<subscriber>& list = m_subscribers[version_index][event];
+
+        // Subscribers may be added by the listeners themselves, hence the index loop.
+        // A failing listener does not prevent the others from being called, the
+        // first error is reported to robot afterwards.
+        std::exception_ptr error;
+        for (std::size_t i = 0; i < list.size(); ++i)
+        {
+            py::object method = list[i].m_method;
+            try
+            {
+                method(*args);
+            }
+            catch (py::error_already_set&)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
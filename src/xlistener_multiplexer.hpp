@@ -0,0 +1,62 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_LISTENER_MULTIPLEXER_HPP
+#define XROB_LISTENER_MULTIPLEXER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Groups robot listeners behind a single listener per listener API
+     * version. Each event is dispatched only to the listeners implementing
+     * it, and robot only sees the events having at least one subscriber.
+     *
+     * Listeners can be added while a run is in progress, they get the events
+     * already subscribed by the listener given to robot.
+     *
+     * All the methods must be called with the GIL held.
+     */
+    class listener_multiplexer
+    {
+    public:
+
+        void add(const py::object& listener);
+        void remove(const py::object& listener);
+
+        // Listeners to pass to robot for the next run: the given listeners
+        // followed by the multiplexing ones
+        py::list make_listeners(const py::list& direct_listeners);
+
+    private:
+
+        struct subscriber
+        {
+            py::object m_listener;
+            py::object m_method;
+        };
+
+        using subscriber_map = std::map<std::string, std::vector<subscriber>>;
+
+        void dispatch(std::size_t version_index, const std::string& event, const py::args& args);
+
+        // Indexed by listener API version, 2 and 3
+        subscriber_map m_subscribers[2];
+    };
+}
+
+#endif
@@ -0,0 +1,99 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "pybind11/pybind11.h"
+
+#include "xeus-python/xutils.hpp"
+
+#include "xinternal_utils.hpp"
+#include "xmodule_registry.hpp"
+
+namespace xrob
+{
+    namespace
+    {
+        const char* drop_library_cache_py = R"py(
+def drop_library_cache(name):
+    try:
+        from robot.running.namespace import IMPORTER
+        cache = IMPORTER._library_cache
+        keys, items = cache._keys, cache._items
+    except (ImportError, AttributeError):
+        return
+    # Library keys are (name, positional args, named args) tuples
+    for index in reversed(range(len(keys))):
+        key = keys[index]
+        if isinstance(key, tuple) and key and key[0] == name:
+            del keys[index]
+            del items[index]
+)py";
+
+        std::size_t hash_code(const std::string& code)
+        {
+            return std::hash<std::string>()(code);
+        }
+    }
+
+    py::object module_registry::find(const std::string& name, const std::string& code) const
+    {
+        auto it = m_modules.find(name);
+        if (it == m_modules.end() || it->second.m_size != code.size() || it->second.m_hash != hash_code(code))
+        {
+            return py::none();
+        }
+        return it->second.m_compiled_code;
+    }
+
+    bool module_registry::insert(const std::string& name, const std::string& code, py::object compiled_code)
+    {
+        module_entry entry = {hash_code(code), code.size(), std::move(compiled_code)};
+        auto res = m_modules.emplace(name, entry);
+        if (!res.second)
+        {
+            res.first->second = std::move(entry);
+        }
+        return res.second;
+    }
+
+    void module_registry::erase(const std::string& name)
+    {
+        m_modules.erase(name);
+    }
+
+    void exec_module(const py::object& compiled_code, const std::string& name)
+    {
+        py::object drop_library_cache = get_embedded_scope(drop_library_cache_py)["drop_library_cache"];
+
+        py::dict modules = py::module::import("sys").attr("modules");
+        py::str modulename(name);
+
+        py::object module;
+        if (modules.contains(modulename))
+        {
+            module = modules[modulename];
+        }
+        else
+        {
+            module = py::module::import("types").attr("ModuleType")(modulename);
+            modules[modulename] = module;
+        }
+
+        // Inject display in the scope
+        module.attr("__dict__")["display"] = py::module::import("IPython.display").attr("display");
+
+        xpyt::exec(compiled_code, module.attr("__dict__"));
+
+        drop_library_cache(modulename);
+    }
+}
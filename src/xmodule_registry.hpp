@@ -0,0 +1,63 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_MODULE_REGISTRY_HPP
+#define XROB_MODULE_REGISTRY_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Compiled code of the %%python module cells, keyed by module name
+     * and content hash. Running a cell again with the same source reuses
+     * the compiled code, changed sources are executed in the existing
+     * module so that the objects robot already imported see the change.
+     *
+     * All the methods must be called with the GIL held.
+     */
+    class module_registry
+    {
+    public:
+
+        // Compiled code of the module if it was registered with the same
+        // source, None otherwise
+        py::object find(const std::string& name, const std::string& code) const;
+
+        // Returns false if the module was already registered
+        bool insert(const std::string& name, const std::string& code, py::object compiled_code);
+
+        void erase(const std::string& name);
+
+    private:
+
+        struct module_entry
+        {
+            std::size_t m_hash;
+            std::size_t m_size;
+            py::object m_compiled_code;
+        };
+
+        std::map<std::string, module_entry> m_modules;
+    };
+
+    // Executes the module code in the module registered in sys.modules under
+    // that name, creating it if needed. Robot's import cache is purged of the
+    // library so that its next import picks up the new definitions.
+    void exec_module(const py::object& compiled_code, const std::string& name);
+}
+
+#endif
@@ -0,0 +1,240 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+#include "xoutput_pool.hpp"
+#include "xtrace.hpp"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace xrob
+{
+    namespace
+    {
+        std::size_t directory_size(const std::string& path)
+        {
+            py::module os = py::module::import("os");
+            py::object getsize = os.attr("path").attr("getsize");
+            py::object join = os.attr("path").attr("join");
+
+            std::size_t size = 0;
+            for (const py::handle& entry : os.attr("walk")(path))
+            {
+                py::tuple walk_entry = py::reinterpret_borrow<py::tuple>(entry);
+                for (const py::handle& file : walk_entry[2])
+                {
+                    try
+                    {
+                        size += getsize(join(walk_entry[0], file)).cast<std::size_t>();
+                    }
+                    catch (py::error_already_set&)
+                    {
+                        // The file vanished in between
+                    }
+                }
+            }
+            return size;
+        }
+
+        void remove_directory(const std::string& path)
+        {
+            py::module::import("shutil").attr("rmtree")(path, "ignore_errors"_a=true);
+        }
+
+        void wipe_directory(const std::string& path)
+        {
+            remove_directory(path);
+            py::module::import("os").attr("makedirs")(path, "exist_ok"_a=true);
+        }
+    }
+
+    output_pool::output_pool(std::size_t size, std::size_t max_pending_bytes)
+        : m_size(size)
+        , m_max_pending_bytes(max_pending_bytes)
+        , m_pending_bytes(0)
+        , m_stop(false)
+    {
+    }
+
+    output_pool::~output_pool()
+    {
+        // The GIL is not held here, the worker can finish its current wipe
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        if (m_worker.joinable())
+        {
+            m_worker.join();
+        }
+    }
+
+    void output_pool::start()
+    {
+        if (m_size == 0)
+        {
+            return;
+        }
+
+        py::module os = py::module::import("os");
+        m_root = py::str(py::module::import("tempfile").attr("mkdtemp")("prefix"_a="xrobot_outputs_"));
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            std::string path = py::str(os.attr("path").attr("join")(m_root, std::to_string(i)));
+            os.attr("makedirs")(path, "exist_ok"_a=true);
+            m_pooled.insert(path);
+            m_free.push_back(path);
+        }
+
+        m_worker = std::thread(&output_pool::run, this);
+    }
+
+    void output_pool::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+
+        if (m_worker.joinable())
+        {
+            // The worker needs the GIL to complete its current wipe
+            py::gil_scoped_release release;
+            m_worker.join();
+        }
+
+        if (!m_root.empty())
+        {
+            remove_directory(m_root);
+            m_root.clear();
+        }
+    }
+
+    std::string output_pool::acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_free.empty())
+            {
+                std::string path = std::move(m_free.front());
+                m_free.pop_front();
+                return path;
+            }
+        }
+
+        // Synchronous fallback when the pool runs dry
+        return py::str(py::module::import("tempfile").attr("mkdtemp")("prefix"_a="xrobot_output_"));
+    }
+
+    void output_pool::release(const std::string& path)
+    {
+        if (m_pooled.find(path) != m_pooled.end())
+        {
+            // The size of the directory is measured by the worker, the cap
+            // applies to the directories it has measured and not wiped yet
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_stop && m_pending_bytes <= m_max_pending_bytes)
+                {
+                    m_released.push_back(path);
+                    m_cv.notify_one();
+                    return;
+                }
+            }
+
+            // Too much data is waiting for cleanup, wipe it right away
+            wipe_directory(path);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(path);
+        }
+        else
+        {
+            remove_directory(path);
+        }
+    }
+
+    void output_pool::run()
+    {
+        set_trace_thread_name("output pool");
+        while (true)
+        {
+            std::deque<std::string> released;
+            std::pair<std::string, std::size_t> entry;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_stop || !m_released.empty() || !m_dirty.empty(); });
+                if (m_stop)
+                {
+                    return;
+                }
+                if (!m_released.empty())
+                {
+                    released.swap(m_released);
+                }
+                else
+                {
+                    entry = std::move(m_dirty.front());
+                    m_dirty.pop_front();
+                }
+            }
+
+            if (!released.empty())
+            {
+                // Directories are measured as soon as they are released, before
+                // the next wipe, so that release sees the whole backlog
+                std::vector<std::size_t> sizes;
+                {
+                    py::gil_scoped_acquire acquire;
+                    for (const std::string& path : released)
+                    {
+                        sizes.push_back(directory_size(path));
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (std::size_t i = 0; i < released.size(); ++i)
+                {
+                    m_pending_bytes += sizes[i];
+                    m_dirty.emplace_back(std::move(released[i]), sizes[i]);
+                }
+                continue;
+            }
+
+            bool wiped = true;
+            {
+                py::gil_scoped_acquire acquire;
+                try
+                {
+                    wipe_directory(entry.first);
+                }
+                catch (py::error_already_set&)
+                {
+                    wiped = false;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending_bytes -= entry.second;
+            // A directory that could not be wiped leaves the pool
+            if (wiped)
+            {
+                m_free.push_back(std::move(entry.first));
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_OUTPUT_POOL_HPP
+#define XROB_OUTPUT_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace xrob
+{
+    /**
+     * Pool of pre-created robot output directories. Released directories
+     * are measured and wiped by a background thread so that the cleanup
+     * does not delay the execution reply. When the pool runs dry, or when the directories
+     * waiting for cleanup exceed the disk usage cap, directories are
+     * created and deleted synchronously instead.
+     *
+     * All the methods except the destructor must be called with the GIL held.
+     */
+    class output_pool
+    {
+    public:
+
+        output_pool(std::size_t size, std::size_t max_pending_bytes);
+        ~output_pool();
+
+        output_pool(const output_pool&) = delete;
+        output_pool& operator=(const output_pool&) = delete;
+
+        void start();
+        void stop();
+
+        std::string acquire();
+        void release(const std::string& path);
+
+    private:
+
+        void run();
+
+        std::size_t m_size;
+        std::size_t m_max_pending_bytes;
+        std::size_t m_pending_bytes;
+        std::string m_root;
+
+        std::set<std::string> m_pooled;
+        std::deque<std::string> m_free;
+        // Released directories not measured yet, then measured ones waiting for their wipe
+        std::deque<std::string> m_released;
+        std::deque<std::pair<std::string, std::size_t>> m_dirty;
+
+        bool m_stop;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::thread m_worker;
+    };
+}
+
+#endif
@@ -0,0 +1,334 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+#include "xcell_classifier.hpp"
+#include "xinternal_utils.hpp"
+#include "xinterrupt.hpp"
+#include "xparallel.hpp"
+#include "xtokenizer.hpp"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace xrob
+{
+    namespace
+    {
+        // Writes the suite and the Python modules to the output directory, runs
+        // one robot process per shard and combines the outputs of the shards
+        const char* run_shards_py = R"py(
+import os
+import re
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+from robot.api import ExecutionResult
+
+def stop_worker(process):
+    # Robot stops the worker gracefully on SIGINT and still writes its output
+    if process.poll() is None:
+        if os.name == "posix":
+            process.send_signal(signal.SIGINT)
+        else:
+            process.terminate()
+
+def wait_worker(process, deadline, interrupted, processes, stop):
+    # Polls the worker so that an interruption of the kernel reaches all the workers.
+    # The stop is sent once for all the workers, a second SIGINT makes robot exit
+    # without writing its output
+    while True:
+        remaining = None if deadline is None else deadline - time.monotonic()
+        try:
+            process.wait(0.1 if remaining is None else max(0, min(0.1, remaining)))
+            return True
+        except subprocess.TimeoutExpired:
+            if remaining is not None and remaining <= 0.1:
+                return False
+        if not stop["sent"] and interrupted():
+            stop["sent"] = True
+            for other, _, _ in processes:
+                stop_worker(other)
+
+def run_shards(source, modules, shards, suite_name, outputdir, timeout, interrupted):
+    workdir = os.path.join(outputdir, "parallel")
+    pythonpath = os.path.join(workdir, "pythonpath")
+    os.makedirs(pythonpath, exist_ok=True)
+
+    suite_file = os.path.join(workdir, "suite.robot")
+    with open(suite_file, "w", encoding="utf-8") as f:
+        f.write(source)
+
+    for name, code in modules.items():
+        with open(os.path.join(pythonpath, name + ".py"), "w", encoding="utf-8") as f:
+            f.write(code)
+
+    processes = []
+    try:
+        for index, shard in enumerate(shards):
+            output = os.path.join(workdir, "output-%d.xml" % index)
+            if os.path.exists(output):
+                os.remove(output)
+            cmd = [
+                sys.executable, "-m", "robot",
+                "--name", suite_name,
+                "--output", output, "--log", "NONE", "--report", "NONE",
+                "--console", "none", "--pythonpath", pythonpath
+            ]
+            for task in shard:
+                # Task names are matched as patterns
+                cmd += ["--test", re.sub(r"([*?\[])", r"[\1]", task)]
+            cmd.append(suite_file)
+            # Stderr goes to a file, a pipe left unread while waiting for the
+            # other shards would block a chatty worker
+            stderr = tempfile.TemporaryFile(dir=workdir)
+            # Workers get their own process group, the interrupt of the kernel
+            # reaches them through stop_worker only
+            if os.name == "posix":
+                group = {"start_new_session": True}
+            else:
+                group = {"creationflags": subprocess.CREATE_NEW_PROCESS_GROUP}
+            process = subprocess.Popen(cmd, cwd=os.getcwd(), stdout=subprocess.DEVNULL, stderr=stderr, **group)
+            processes.append((process, output, stderr))
+
+        deadline = time.monotonic() + timeout if timeout else None
+        stop = {"sent": False}
+        outputs = []
+        errors = []
+        for process, output, stderr in processes:
+            if not wait_worker(process, deadline, interrupted, processes, stop):
+                errors.append("Shard timed out after %d seconds" % timeout)
+                continue
+            stderr.seek(0)
+            message = stderr.read().decode(errors="replace")
+            if os.path.exists(output):
+                outputs.append(output)
+                if message:
+                    sys.stderr.write(message)
+            else:
+                errors.append(message)
+    finally:
+        for process, _, stderr in processes:
+            if process.poll() is None:
+                process.kill()
+                process.wait()
+            stderr.close()
+
+    if errors:
+        raise RuntimeError("Parallel execution failed:\n" + "\n".join(errors))
+
+    result = ExecutionResult(*outputs)
+    result.save(os.path.join(outputdir, "output.xml"))
+    return result
+)py";
+
+        std::string normalize(std::string name)
+        {
+            name.erase(std::remove_if(name.begin(), name.end(), [](char c) { return c == ' ' || c == '_'; }), name.end());
+            std::transform(name.begin(), name.end(), name.begin(), [](char c)
+            {
+                return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            });
+            return name;
+        }
+
+        std::string first_cell(section_kind kind, const std::string& line)
+        {
+            line_state state;
+            state.m_section = kind;
+            std::vector<token> tokens;
+            tokenize_line(line.data(), line.size(), 0, 0, state, tokens);
+            if (tokens.empty())
+            {
+                return "";
+            }
+            std::string cell = line.substr(tokens.front().m_offset, tokens.front().m_length);
+            cell.erase(cell.find_last_not_of(" =") + 1);
+            return cell;
+        }
+
+        std::string get_block_key(section_kind kind, const std::string& line)
+        {
+            std::string name = first_cell(kind, line);
+            if (kind == section_kind::settings)
+            {
+                // Imports may appear several times, other settings only once
+                std::string setting = normalize(name);
+                if (setting == "library" || setting == "resource" || setting == "variables")
+                {
+                    return line.substr(0, line.find_last_not_of(" \t\r") + 1);
+                }
+                return setting;
+            }
+            return normalize(name);
+        }
+    }
+
+    void session_definitions::add_cell(const cell_info& cell, const std::string& code)
+    {
+        for (const section_range& section : cell.m_sections)
+        {
+            block_list* blocks = nullptr;
+            switch (section.m_kind)
+            {
+                case section_kind::settings:
+                    blocks = &m_settings;
+                    break;
+                case section_kind::variables:
+                    blocks = &m_variables;
+                    break;
+                case section_kind::keywords:
+                    blocks = &m_keywords;
+                    break;
+                default:
+                    break;
+            }
+
+            if (blocks == nullptr)
+            {
+                continue;
+            }
+
+            // A block starts with a non indented line and holds the following indented lines
+            std::string key;
+            std::string block;
+            std::size_t pos = code.find('\n', section.m_begin);
+            pos = pos == std::string::npos ? section.m_end : pos + 1;
+            while (pos < section.m_end)
+            {
+                std::size_t end = std::min(code.find('\n', pos), section.m_end);
+                std::string line = code.substr(pos, end - pos);
+                bool starts_block = !line.empty() && line[0] != ' ' && line[0] != '\t' && line[0] != '#' && line[0] != '\r';
+                if (starts_block)
+                {
+                    if (!key.empty())
+                    {
+                        add_block(*blocks, std::move(key), std::move(block));
+                    }
+                    key = get_block_key(section.m_kind, line);
+                    block.clear();
+                }
+                if (!key.empty())
+                {
+                    block += line + "\n";
+                }
+                pos = end + 1;
+            }
+
+            if (!key.empty())
+            {
+                add_block(*blocks, std::move(key), std::move(block));
+            }
+        }
+    }
+
+    void session_definitions::add_python_module(const std::string& name, const std::string& code)
+    {
+        m_python_modules[name] = code;
+    }
+
+    std::string session_definitions::get_robot_source() const
+    {
+        std::string source;
+        auto append_section = [&source](const char* header, const block_list& blocks)
+        {
+            if (!blocks.empty())
+            {
+                source += header;
+                for (const auto& block : blocks)
+                {
+                    source += block.second;
+                }
+                source += "\n";
+            }
+        };
+
+        append_section("*** Settings ***\n", m_settings);
+        append_section("*** Variables ***\n", m_variables);
+        append_section("*** Keywords ***\n", m_keywords);
+        return source;
+    }
+
+    const std::map<std::string, std::string>& session_definitions::get_python_modules() const
+    {
+        return m_python_modules;
+    }
+
+    void session_definitions::add_block(block_list& blocks, std::string key, std::string block)
+    {
+        auto it = std::find_if(blocks.begin(), blocks.end(), [&key](const std::pair<std::string, std::string>& b)
+        {
+            return b.first == key;
+        });
+
+        if (it != blocks.end())
+        {
+            it->second = std::move(block);
+        }
+        else
+        {
+            blocks.emplace_back(std::move(key), std::move(block));
+        }
+    }
+
+    bool is_task_only_cell(const cell_info& cell)
+    {
+        bool has_tasks = false;
+        for (const section_range& section : cell.m_sections)
+        {
+            switch (section.m_kind)
+            {
+                case section_kind::tasks:
+                case section_kind::test_cases:
+                    has_tasks = true;
+                    break;
+                case section_kind::comments:
+                    break;
+                default:
+                    return false;
+            }
+        }
+        return has_tasks;
+    }
+
+    py::object run_sharded_tasks(const session_definitions& definitions,
+                                 const std::string& code,
+                                 const std::vector<std::string>& tasks,
+                                 std::size_t worker_count,
+                                 const std::string& suite_name,
+                                 const std::string& outputdir,
+                                 std::size_t timeout)
+    {
+        py::object run_shards = get_embedded_scope(run_shards_py)["run_shards"];
+
+        // Round robin distribution of the tasks
+        std::size_t shard_count = std::min(worker_count, tasks.size());
+        std::vector<std::vector<std::string>> shards(shard_count);
+        for (std::size_t i = 0; i < tasks.size(); ++i)
+        {
+            shards[i % shard_count].push_back(tasks[i]);
+        }
+
+        std::string source = definitions.get_robot_source() + code;
+        py::cpp_function interrupted([]() { return is_interrupt_requested(); });
+        return run_shards(source, definitions.get_python_modules(), shards, suite_name, outputdir, timeout, interrupted);
+    }
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_PARALLEL_HPP
+#define XROB_PARALLEL_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+#include "xcell_classifier.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Settings, variables and keywords defined by the cells executed so far,
+     * used to pre-load the worker processes of parallel executions. Later
+     * definitions of a variable or of a keyword replace the earlier ones.
+     */
+    class session_definitions
+    {
+    public:
+
+        void add_cell(const cell_info& cell, const std::string& code);
+        void add_python_module(const std::string& name, const std::string& code);
+
+        // Content of a robot file holding all the definitions
+        std::string get_robot_source() const;
+        const std::map<std::string, std::string>& get_python_modules() const;
+
+    private:
+
+        using block_list = std::vector<std::pair<std::string, std::string>>;
+
+        void add_block(block_list& blocks, std::string key, std::string block);
+
+        block_list m_settings;
+        block_list m_variables;
+        block_list m_keywords;
+        std::map<std::string, std::string> m_python_modules;
+    };
+
+    // Whether the cell only holds tasks or test cases and can be sharded
+    bool is_task_only_cell(const cell_info& cell);
+
+    /**
+     * Runs the given tasks of a robot source in worker processes, returns
+     * the combined robot result. Workers still running after timeout seconds
+     * are killed, 0 waits without limit. An interruption of the kernel stops
+     * the workers gracefully, a second one kills them. The GIL must be held.
+     */
+    py::object run_sharded_tasks(const session_definitions& definitions,
+                                 const std::string& code,
+                                 const std::vector<std::string>& tasks,
+                                 std::size_t worker_count,
+                                 const std::string& suite_name,
+                                 const std::string& outputdir,
+                                 std::size_t timeout);
+}
+
+#endif
@@ -0,0 +1,103 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+#include "xparse_cache.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    parse_cache::parse_cache(std::size_t capacity)
+        : m_capacity(capacity)
+    {
+    }
+
+    const parsed_cell* parse_cache::find(const std::string& key)
+    {
+        auto it = m_index.find(key);
+        if (it == m_index.end())
+        {
+            return nullptr;
+        }
+
+        // Move the entry to the front, it is now the most recently used
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return &(it->second->second);
+    }
+
+    const parsed_cell& parse_cache::insert(const std::string& key, parsed_cell cell)
+    {
+        auto it = m_index.find(key);
+        if (it != m_index.end())
+        {
+            m_entries.erase(it->second);
+            m_index.erase(it);
+        }
+
+        m_entries.emplace_front(key, std::move(cell));
+        m_index[key] = m_entries.begin();
+
+        while (m_entries.size() > m_capacity)
+        {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+
+        return m_entries.front().second;
+    }
+
+    void parse_cache::clear()
+    {
+        m_index.clear();
+        m_entries.clear();
+    }
+
+    std::size_t parse_cache::size() const
+    {
+        return m_entries.size();
+    }
+
+    std::size_t parse_cache::capacity() const
+    {
+        return m_capacity;
+    }
+
+    parsed_cell parse_robot_cell(const py::object& get_model, const py::object& source, const py::kwargs& kwargs)
+    {
+        parsed_cell cell;
+        cell.m_model = get_model(source, **kwargs);
+
+        // Build the keyword table of the cell
+        for (const py::handle& section : cell.m_model.attr("sections"))
+        {
+            std::string section_type = py::str(section.get_type().attr("__name__"));
+            if (section_type != "KeywordSection")
+            {
+                continue;
+            }
+
+            for (const py::handle& keyword : section.attr("body"))
+            {
+                if (py::hasattr(keyword, "name") && !keyword.attr("name").is_none())
+                {
+                    cell.m_keywords.push_back(py::str(keyword.attr("name")));
+                }
+            }
+        }
+
+        return cell;
+    }
+}
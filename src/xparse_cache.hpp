@@ -0,0 +1,64 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_PARSE_CACHE_HPP
+#define XROB_PARSE_CACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    struct parsed_cell
+    {
+        // Robot model returned by robot.api.get_model
+        py::object m_model;
+        // Names of the keywords defined in the cell
+        std::vector<std::string> m_keywords;
+    };
+
+    /**
+     * Bounded LRU cache of parsed robot cells, keyed on the hash
+     * of the cell content. The GIL must be held when using it.
+     */
+    class parse_cache
+    {
+    public:
+
+        explicit parse_cache(std::size_t capacity);
+
+        const parsed_cell* find(const std::string& key);
+        const parsed_cell& insert(const std::string& key, parsed_cell cell);
+        void clear();
+
+        std::size_t size() const;
+        std::size_t capacity() const;
+
+    private:
+
+        using entry_list = std::list<std::pair<std::string, parsed_cell>>;
+
+        entry_list m_entries;
+        std::unordered_map<std::string, entry_list::iterator> m_index;
+        std::size_t m_capacity;
+    };
+
+    parsed_cell parse_robot_cell(const py::object& get_model, const py::object& source, const py::kwargs& kwargs);
+}
+
+#endif
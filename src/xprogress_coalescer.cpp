@@ -0,0 +1,185 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <chrono>
+#include <mutex>
+#include <utility>
+
+#include "pybind11/pybind11.h"
+
+#include "xprogress_coalescer.hpp"
+#include "xtrace.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    progress_coalescer::progress_coalescer(std::size_t frame_rate)
+        : m_interval(clock_type::duration::zero())
+        , m_active(false)
+        , m_dirty(false)
+        , m_stop(false)
+        , m_generation(0)
+    {
+        if (frame_rate != 0)
+        {
+            m_interval = std::chrono::duration_cast<clock_type::duration>(std::chrono::seconds(1)) / frame_rate;
+            m_worker = std::thread(&progress_coalescer::run, this);
+        }
+    }
+
+    progress_coalescer::~progress_coalescer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        if (m_worker.joinable())
+        {
+            m_worker.join();
+        }
+    }
+
+    void progress_coalescer::start(py::object update_display)
+    {
+        m_update_display = std::move(update_display);
+        m_latest_args = py::object();
+        m_latest_kwargs = py::object();
+        m_sent_args = py::object();
+        m_sent_kwargs = py::object();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_generation;
+        m_active = true;
+        m_dirty = false;
+        m_last_flush = clock_type::time_point();
+    }
+
+    void progress_coalescer::push(py::args args, py::kwargs kwargs)
+    {
+        m_latest_args = std::move(args);
+        m_latest_kwargs = std::move(kwargs);
+
+        bool flush_now = true;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_active && m_interval != clock_type::duration::zero())
+            {
+                clock_type::time_point now = clock_type::now();
+                flush_now = now - m_last_flush >= m_interval;
+                m_dirty = !flush_now;
+                if (flush_now)
+                {
+                    m_last_flush = now;
+                }
+            }
+        }
+
+        if (flush_now)
+        {
+            send();
+        }
+        else
+        {
+            m_cv.notify_one();
+        }
+    }
+
+    void progress_coalescer::finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_generation;
+            m_active = false;
+            m_dirty = false;
+        }
+
+        // Final authoritative update, pending updates from the worker are dropped
+        send();
+    }
+
+    void progress_coalescer::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+
+        if (m_worker.joinable())
+        {
+            // The worker may be waiting for the GIL
+            py::gil_scoped_release release;
+            m_worker.join();
+        }
+    }
+
+    void progress_coalescer::run()
+    {
+        set_trace_thread_name("progress");
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop)
+        {
+            if (!m_dirty)
+            {
+                m_cv.wait(lock);
+                continue;
+            }
+
+            clock_type::time_point deadline = m_last_flush + m_interval;
+            if (clock_type::now() < deadline)
+            {
+                m_cv.wait_until(lock, deadline);
+                continue;
+            }
+
+            std::size_t generation = m_generation;
+            lock.unlock();
+            {
+                // The mutex is never held while waiting for the GIL
+                py::gil_scoped_acquire acquire;
+                std::unique_lock<std::mutex> check(m_mutex);
+                if (m_dirty && m_generation == generation)
+                {
+                    m_dirty = false;
+                    m_last_flush = clock_type::now();
+                    check.unlock();
+                    send();
+                }
+            }
+            lock.lock();
+        }
+    }
+
+    void progress_coalescer::send()
+    {
+        if (!m_latest_args || !m_update_display)
+        {
+            return;
+        }
+
+        if (m_sent_args && m_latest_args.equal(m_sent_args) && m_latest_kwargs.equal(m_sent_kwargs))
+        {
+            return;
+        }
+
+        try
+        {
+            m_update_display(*m_latest_args, **m_latest_kwargs);
+            m_sent_args = m_latest_args;
+            m_sent_kwargs = m_latest_kwargs;
+        }
+        catch (py::error_already_set&)
+        {
+            // A failing progress update must not abort the execution
+        }
+    }
+}
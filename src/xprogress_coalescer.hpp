@@ -0,0 +1,78 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_PROGRESS_COALESCER_HPP
+#define XROB_PROGRESS_COALESCER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Throttles the progress display updates of an execution to a maximum
+     * frame rate. Updates received in between two frames are coalesced, only
+     * the latest one is sent, either on the next frame or by finish().
+     * Updates identical to the last sent one are dropped.
+     *
+     * All the methods except the destructor must be called with the GIL held.
+     */
+    class progress_coalescer
+    {
+    public:
+
+        using clock_type = std::chrono::steady_clock;
+
+        // A frame rate of 0 disables the coalescing
+        explicit progress_coalescer(std::size_t frame_rate);
+        ~progress_coalescer();
+
+        progress_coalescer(const progress_coalescer&) = delete;
+        progress_coalescer& operator=(const progress_coalescer&) = delete;
+
+        void start(py::object update_display);
+        void push(py::args args, py::kwargs kwargs);
+        void finish();
+
+        void stop();
+
+    private:
+
+        void run();
+        void send();
+
+        clock_type::duration m_interval;
+
+        py::object m_update_display;
+        py::object m_latest_args;
+        py::object m_latest_kwargs;
+        py::object m_sent_args;
+        py::object m_sent_kwargs;
+
+        bool m_active;
+        bool m_dirty;
+        bool m_stop;
+        std::size_t m_generation;
+        clock_type::time_point m_last_flush;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::thread m_worker;
+    };
+}
+
+#endif
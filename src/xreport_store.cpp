@@ -0,0 +1,85 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <string>
+#include <utility>
+
+#include "pybind11/pybind11.h"
+
+#include "xeus/xguid.hpp"
+
+#include "xreport_store.hpp"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace xrob
+{
+    report_store::report_store(std::size_t capacity)
+        : m_capacity(capacity)
+    {
+    }
+
+    std::string report_store::retain(py::object builder, const std::string& directory)
+    {
+        std::string handle = xeus::new_xguid();
+        m_entries.push_front({handle, directory, std::move(builder), py::none()});
+        m_index[handle] = m_entries.begin();
+
+        while (m_entries.size() > m_capacity)
+        {
+            release(m_entries.back());
+            m_index.erase(m_entries.back().m_handle);
+            m_entries.pop_back();
+        }
+
+        return handle;
+    }
+
+    py::object report_store::build(const std::string& handle)
+    {
+        auto it = m_index.find(handle);
+        if (it == m_index.end())
+        {
+            return py::none();
+        }
+
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        entry& e = *(it->second);
+
+        // The report is built once, the retained outputs are not needed afterwards
+        if (e.m_report.is_none())
+        {
+            e.m_report = e.m_builder();
+            release(e);
+        }
+        return e.m_report;
+    }
+
+    void report_store::clear()
+    {
+        for (entry& e : m_entries)
+        {
+            release(e);
+        }
+        m_index.clear();
+        m_entries.clear();
+    }
+
+    void report_store::release(entry& e)
+    {
+        e.m_builder = py::none();
+        if (!e.m_directory.empty())
+        {
+            py::module::import("shutil").attr("rmtree")(e.m_directory, "ignore_errors"_a=true);
+            e.m_directory.clear();
+        }
+    }
+}
@@ -0,0 +1,68 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_REPORT_STORE_HPP
+#define XROB_REPORT_STORE_HPP
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "pybind11/pybind11.h"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    /**
+     * Retains what is needed to build the HTML report of past executions
+     * so that it is only generated when the frontend asks for it. The
+     * GIL must be held when using the store.
+     */
+    class report_store
+    {
+    public:
+
+        explicit report_store(std::size_t capacity);
+
+        report_store(const report_store&) = delete;
+        report_store& operator=(const report_store&) = delete;
+
+        // builder is called without argument and returns the report mime bundle,
+        // directory holds the retained robot outputs and is removed on eviction
+        std::string retain(py::object builder, const std::string& directory);
+
+        // Returns None when the handle is unknown or has been evicted
+        py::object build(const std::string& handle);
+
+        void clear();
+
+    private:
+
+        struct entry
+        {
+            std::string m_handle;
+            std::string m_directory;
+            py::object m_builder;
+            py::object m_report;
+        };
+
+        void release(entry& e);
+
+        using entry_list = std::list<entry>;
+
+        std::size_t m_capacity;
+        entry_list m_entries;
+        std::unordered_map<std::string, entry_list::iterator> m_index;
+    };
+}
+
+#endif
@@ -0,0 +1,158 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "pybind11/pybind11.h"
+
+#include "xresult_summary.hpp"
+#include "xtraceback.hpp"
+
+namespace nl = nlohmann;
+namespace py = pybind11;
+
+namespace xrob
+{
+    namespace
+    {
+        double get_elapsed_ms(const py::handle& item)
+        {
+            // Robot Framework 7 replaced elapsedtime (ms) with elapsed_time (timedelta)
+            if (py::hasattr(item, "elapsed_time"))
+            {
+                return item.attr("elapsed_time").attr("total_seconds")().cast<double>() * 1000.;
+            }
+            if (py::hasattr(item, "elapsedtime"))
+            {
+                return item.attr("elapsedtime").cast<double>();
+            }
+            return 0.;
+        }
+    }
+
+    std::size_t result_summary::total() const
+    {
+        return m_passed + m_failed + m_skipped;
+    }
+
+    nl::json result_summary::to_json() const
+    {
+        nl::json failures = nl::json::array();
+        for (const task_failure& failure : m_failures)
+        {
+            failures.push_back({
+                {"name", failure.m_name},
+                {"message", failure.m_message},
+                {"elapsed_ms", failure.m_elapsed_ms}
+            });
+        }
+
+        return {
+            {"total", total()},
+            {"passed", m_passed},
+            {"failed", m_failed},
+            {"skipped", m_skipped},
+            {"suites", m_suites},
+            {"elapsed_ms", m_elapsed_ms},
+            {"failures", failures}
+        };
+    }
+
+    result_summary summarize_result(const py::handle& suite, std::size_t max_failures)
+    {
+        result_summary summary;
+        summary.m_elapsed_ms = get_elapsed_ms(suite);
+
+        py::str pass_status("PASS");
+        py::str skip_status("SKIP");
+
+        // Explicit stack of (suite, path) to handle arbitrarily nested suites,
+        // the name of the root suite is not part of the task names
+        std::vector<std::pair<py::object, std::string>> suites;
+        suites.emplace_back(py::reinterpret_borrow<py::object>(suite), std::string());
+        while (!suites.empty())
+        {
+            py::object current = std::move(suites.back().first);
+            std::string path = std::move(suites.back().second);
+            suites.pop_back();
+            ++summary.m_suites;
+
+            for (const py::handle& test : current.attr("tests"))
+            {
+                py::object status = test.attr("status");
+                if (status.equal(pass_status))
+                {
+                    ++summary.m_passed;
+                }
+                else if (status.equal(skip_status))
+                {
+                    ++summary.m_skipped;
+                }
+                else
+                {
+                    ++summary.m_failed;
+                    if (summary.m_failures.size() < max_failures)
+                    {
+                        summary.m_failures.push_back({
+                            path + py::str(test.attr("name")).cast<std::string>(),
+                            py::str(test.attr("message")).cast<std::string>(),
+                            get_elapsed_ms(test)
+                        });
+                    }
+                }
+            }
+
+            // Children are pushed in reverse so that they are popped, and their
+            // failures reported, in the order of the suite
+            std::size_t first_child = suites.size();
+            for (const py::handle& child : current.attr("suites"))
+            {
+                suites.emplace_back(
+                    py::reinterpret_borrow<py::object>(child),
+                    path + py::str(child.attr("name")).cast<std::string>() + "."
+                );
+            }
+            std::reverse(suites.begin() + static_cast<std::ptrdiff_t>(first_child), suites.end());
+        }
+
+        return summary;
+    }
+
+    std::vector<std::string> get_failure_traceback(const result_summary& summary, const std::string& error_name)
+    {
+        std::vector<std::string> traceback;
+        traceback.reserve(summary.m_failures.size() + 3);
+        traceback.push_back(first_error_delimiter(error_name));
+
+        for (const task_failure& failure : summary.m_failures)
+        {
+            std::stringstream error_msg;
+            error_msg << "Task " << blue_text(failure.m_name) << " failed with: " << failure.m_message;
+            traceback.push_back(error_msg.str());
+        }
+
+        if (summary.m_failed > summary.m_failures.size())
+        {
+            std::stringstream error_msg;
+            error_msg << "... and " << (summary.m_failed - summary.m_failures.size()) << " more failed task(s)";
+            traceback.push_back(error_msg.str());
+        }
+
+        traceback.push_back(last_error_delimiter());
+        return traceback;
+    }
+}
@@ -0,0 +1,55 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_RESULT_SUMMARY_HPP
+#define XROB_RESULT_SUMMARY_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "pybind11/pybind11.h"
+
+namespace nl = nlohmann;
+namespace py = pybind11;
+
+namespace xrob
+{
+    struct task_failure
+    {
+        std::string m_name;
+        std::string m_message;
+        double m_elapsed_ms;
+    };
+
+    struct result_summary
+    {
+        std::size_t m_passed = 0;
+        std::size_t m_failed = 0;
+        std::size_t m_skipped = 0;
+        std::size_t m_suites = 0;
+        double m_elapsed_ms = 0.;
+        // Bounded, m_failed holds the actual number of failures
+        std::vector<task_failure> m_failures;
+
+        std::size_t total() const;
+        nl::json to_json() const;
+    };
+
+    // Walks the result suite and all its child suites once, the GIL must be held
+    result_summary summarize_result(const py::handle& suite, std::size_t max_failures);
+
+    // Traceback lines listing the failed tasks of a summary
+    std::vector<std::string> get_failure_traceback(const result_summary& summary, const std::string& error_name);
+}
+
+#endif
@@ -12,25 +12,112 @@
 #include "nlohmann/json.hpp"
 #include "xeus/xmessage.hpp"
 #include "xrobodebug_client.hpp"
+#include "xtrace.hpp"
 
 #include <thread>
 #include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
 
 namespace nl = nlohmann;
 
 namespace xrob
 {
+    namespace
+    {
+        std::string get_cache_key(const std::string& command, const nl::json& arguments)
+        {
+            // Object keys are sorted, equal arguments give the same dump
+            return command + arguments.dump();
+        }
+
+        enum class dap_event_kind
+        {
+            stopped,
+            resumed,
+            other
+        };
+
+        // Only the type and event fields are looked at, output events from
+        // chatty keywords go through this for every line they print
+        dap_event_kind sniff_event(const nl::json& message)
+        {
+            auto type = message.find("type");
+            auto event = message.find("event");
+            if (type == message.end() || event == message.end() || !event->is_string() || *type != "event")
+            {
+                return dap_event_kind::other;
+            }
+
+            const std::string& name = event->get_ref<const std::string&>();
+            if (name == "stopped")
+            {
+                return dap_event_kind::stopped;
+            }
+            if (name == "continued" || name == "terminated" || name == "exited")
+            {
+                return dap_event_kind::resumed;
+            }
+            return dap_event_kind::other;
+        }
+
+        // Far above the sequence numbers of the frontend requests
+        constexpr int prefetch_first_seq = 1 << 30;
+    }
+
     xrobodebug_client::xrobodebug_client(zmq::context_t& context,
                                          const xeus::xconfiguration& config,
                                          int socket_linger,
                                          const xdap_tcp_configuration& dap_config,
                                          const event_callback& cb)
         : base_type(context, config, socket_linger, dap_config, cb)
+        , m_cache_generation(0)
+        , m_prefetch_seq(prefetch_first_seq)
     {
     }
 
+    bool xrobodebug_client::get_cached_reply(const nl::json& request, nl::json& reply)
+    {
+        std::string key = get_cache_key(request["command"].get<std::string>(),
+                                        request.value("arguments", nl::json::object()));
+        std::lock_guard<std::mutex> lock(m_cache_mutex);
+        auto it = m_reply_cache.find(key);
+        if (it == m_reply_cache.end())
+        {
+            return false;
+        }
+        reply = it->second;
+        reply["request_seq"] = request["seq"];
+        return true;
+    }
+
     void xrobodebug_client::handle_event(nl::json message)
     {
+        trace_span span("dap event");
+
+        switch (sniff_event(message))
+        {
+            case dap_event_kind::stopped:
+            {
+                // The frontend asks for the stack, the scopes and the variables of
+                // the top frame right after a stop, fetch them before it does
+                clear_cache();
+                auto body = message.find("body");
+                if (body != message.end() && body->contains("threadId"))
+                {
+                    prefetch((*body)["threadId"].get<int>());
+                }
+                break;
+            }
+            case dap_event_kind::resumed:
+                clear_cache();
+                break;
+            default:
+                // Passthrough, the event is forwarded as received
+                break;
+        }
         forward_event(std::move(message));
     }
 
@@ -53,5 +140,79 @@ namespace xrob
         });
         return reply["body"]["stackFrames"];
     }
-}
 
+    nl::json xrobodebug_client::send_request(const std::string& command, nl::json arguments)
+    {
+        trace_span span(command);
+
+        int seq = m_prefetch_seq++;
+        nl::json request = {
+            {"type", "request"},
+            {"seq", seq},
+            {"command", command},
+            {"arguments", std::move(arguments)}
+        };
+
+        send_dap_request(std::move(request));
+
+        // A late response to an earlier request for the same command must not be taken for this one
+        return wait_for_message([seq](const nl::json& message)
+        {
+            return message["type"] == "response" && message.value("request_seq", -1) == seq;
+        });
+    }
+
+    void xrobodebug_client::prefetch(int thread_id)
+    {
+        trace_span span("prefetch");
+
+        std::size_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_cache_mutex);
+            generation = m_cache_generation;
+        }
+
+        std::map<std::string, nl::json> replies;
+        auto fetch = [&](const std::string& command, nl::json arguments) -> const nl::json*
+        {
+            std::string key = get_cache_key(command, arguments);
+            nl::json reply = send_request(command, std::move(arguments));
+            if (!reply.value("success", false))
+            {
+                return nullptr;
+            }
+            return &(replies[key] = std::move(reply));
+        };
+
+        const nl::json* stack = fetch("stackTrace", {{"threadId", thread_id}});
+        if (stack != nullptr && !(*stack)["body"]["stackFrames"].empty())
+        {
+            int frame_id = (*stack)["body"]["stackFrames"][0]["id"].get<int>();
+            const nl::json* scopes = fetch("scopes", {{"frameId", frame_id}});
+            if (scopes != nullptr)
+            {
+                for (const nl::json& scope : (*scopes)["body"]["scopes"])
+                {
+                    int reference = scope.value("variablesReference", 0);
+                    if (reference != 0)
+                    {
+                        fetch("variables", {{"variablesReference", reference}});
+                    }
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_cache_mutex);
+        if (m_cache_generation == generation)
+        {
+            m_reply_cache = std::move(replies);
+        }
+    }
+
+    void xrobodebug_client::clear_cache()
+    {
+        std::lock_guard<std::mutex> lock(m_cache_mutex);
+        m_reply_cache.clear();
+        ++m_cache_generation;
+    }
+}
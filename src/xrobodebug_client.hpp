@@ -11,6 +11,11 @@
 #ifndef XROB_ROBODEBUG_CLIENT_HPP
 #define XROB_ROBODEBUG_CLIENT_HPP
 
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
 #include "xeus-zmq/xdap_tcp_client.hpp"
 
 namespace xrob
@@ -34,10 +39,30 @@ namespace xrob
 
         virtual ~xrobodebug_client() = default;
 
+        // Reply prefetched for this request during the current stop, if any.
+        // Called from the control thread.
+        bool get_cached_reply(const nl::json& request, nl::json& reply);
+
+        // Drops the prefetched replies, requests changing variables make them stale.
+        // Called from the control thread.
+        void clear_cache();
+
     private:
 
         void handle_event(nl::json message) override;
         nl::json get_stack_frames(int thread_id, int seq);
+
+        nl::json send_request(const std::string& command, nl::json arguments);
+        void prefetch(int thread_id);
+
+        // stackTrace, scopes and variables replies of the current stop, keyed
+        // by command and arguments, filled by the client thread
+        std::mutex m_cache_mutex;
+        std::map<std::string, nl::json> m_reply_cache;
+        // Incremented on each clear, replies prefetched before are dropped
+        std::size_t m_cache_generation;
+        // Sequence numbers of the prefetch requests, apart from the ones of the frontend
+        int m_prefetch_seq;
     };
 }
 
@@ -33,6 +33,7 @@
 
 #include "xinterpreter.hpp"
 #include "xdebugger.hpp"
+#include "xtrace.hpp"
 
 namespace py = pybind11;
 
@@ -61,6 +62,7 @@ void launch(const py::list args_list)
     // Registering SIGINT and SIGKILL handlers
     signal(SIGKILL, xpyt::sigkill_handler);
 #endif
+    // Replaced by the cooperative interrupt handler once the interpreter is configured
     signal(SIGINT, xpyt::sigkill_handler);
 
     // Instantiating the xeus xinterpreter
@@ -81,6 +83,9 @@ void launch(const py::list args_list)
 
     auto context = xeus::make_context<zmq::context_t>();
 
+    // xserver_shell_main runs the shell on the calling thread
+    xrob::set_trace_thread_name("shell");
+
     if (!connection_filename.empty())
     {
         xeus::xconfiguration config = xeus::load_configuration(connection_filename);
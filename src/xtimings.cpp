@@ -0,0 +1,171 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "nlohmann/json.hpp"
+
+#include "xtimings.hpp"
+
+namespace nl = nlohmann;
+
+namespace xrob
+{
+    namespace
+    {
+        double to_milliseconds(phase_timer::duration_type duration)
+        {
+            return std::chrono::duration<double, std::milli>(duration).count();
+        }
+
+        std::size_t phase_index(execution_phase phase)
+        {
+            return static_cast<std::size_t>(phase);
+        }
+    }
+
+    const char* get_phase_name(execution_phase phase)
+    {
+        switch (phase)
+        {
+            case execution_phase::parse:
+                return "parse";
+            case execution_phase::run:
+                return "run";
+            case execution_phase::report:
+                return "report";
+            case execution_phase::cleanup:
+                return "cleanup";
+            case execution_phase::publish:
+                return "publish";
+        }
+        return "unknown";
+    }
+
+    phase_timer::phase_timer()
+    {
+        reset();
+    }
+
+    void phase_timer::reset()
+    {
+        m_durations.fill(duration_type::zero());
+    }
+
+    void phase_timer::add(execution_phase phase, duration_type duration)
+    {
+        m_durations[phase_index(phase)] += duration;
+    }
+
+    auto phase_timer::get(execution_phase phase) const -> duration_type
+    {
+        return m_durations[phase_index(phase)];
+    }
+
+    nl::json phase_timer::to_json() const
+    {
+        nl::json timings = nl::json::object();
+        for (std::size_t i = 0; i < execution_phase_count; ++i)
+        {
+            timings[get_phase_name(static_cast<execution_phase>(i))] = to_milliseconds(m_durations[i]);
+        }
+        return timings;
+    }
+
+    scoped_phase::scoped_phase(phase_timer& timer, execution_phase phase)
+        : m_timer(timer)
+        , m_phase(phase)
+        , m_start(phase_timer::clock_type::now())
+        , m_running(true)
+    {
+    }
+
+    scoped_phase::~scoped_phase()
+    {
+        stop();
+    }
+
+    void scoped_phase::stop()
+    {
+        if (m_running)
+        {
+            m_timer.add(m_phase, phase_timer::clock_type::now() - m_start);
+            m_running = false;
+        }
+    }
+
+    constexpr std::size_t phase_histograms::bucket_count;
+
+    phase_histograms::phase_histograms()
+    {
+        for (histogram& h : m_histograms)
+        {
+            h.m_buckets.fill(0);
+        }
+    }
+
+    void phase_histograms::record(const phase_timer& timer)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::size_t i = 0; i < execution_phase_count; ++i)
+        {
+            phase_timer::duration_type duration = timer.get(static_cast<execution_phase>(i));
+            std::uint64_t us = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(duration).count()
+            );
+
+            // Bucket b holds the durations lower than 2^b microseconds
+            std::size_t bucket = 0;
+            while (bucket + 1 < bucket_count && (std::uint64_t(1) << bucket) <= us)
+            {
+                ++bucket;
+            }
+
+            histogram& h = m_histograms[i];
+            ++h.m_count;
+            h.m_total += duration;
+            h.m_max = std::max(h.m_max, duration);
+            ++h.m_buckets[bucket];
+        }
+    }
+
+    nl::json phase_histograms::to_json() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        nl::json result = nl::json::object();
+        for (std::size_t i = 0; i < execution_phase_count; ++i)
+        {
+            const histogram& h = m_histograms[i];
+            nl::json buckets = nl::json::array();
+            for (std::size_t b = 0; b < bucket_count; ++b)
+            {
+                if (h.m_buckets[b] != 0)
+                {
+                    // Bucket b counts the durations strictly below 2^b microseconds
+                    buckets.push_back({
+                        {"lt_ms", static_cast<double>(std::uint64_t(1) << b) / 1000.},
+                        {"count", h.m_buckets[b]}
+                    });
+                }
+            }
+
+            result[get_phase_name(static_cast<execution_phase>(i))] = {
+                {"count", h.m_count},
+                {"total_ms", to_milliseconds(h.m_total)},
+                {"max_ms", to_milliseconds(h.m_max)},
+                {"buckets", buckets}
+            };
+        }
+        return result;
+    }
+}
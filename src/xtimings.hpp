@@ -0,0 +1,116 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_TIMINGS_HPP
+#define XROB_TIMINGS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+#include "nlohmann/json.hpp"
+
+namespace nl = nlohmann;
+
+namespace xrob
+{
+    enum class execution_phase
+    {
+        parse,
+        run,
+        report,
+        cleanup,
+        publish
+    };
+
+    constexpr std::size_t execution_phase_count = 5;
+
+    const char* get_phase_name(execution_phase phase);
+
+    /**
+     * Durations of the phases of a single execution, measured
+     * with a monotonic clock.
+     */
+    class phase_timer
+    {
+    public:
+
+        using clock_type = std::chrono::steady_clock;
+        using duration_type = clock_type::duration;
+
+        phase_timer();
+
+        void reset();
+        void add(execution_phase phase, duration_type duration);
+        duration_type get(execution_phase phase) const;
+
+        nl::json to_json() const;
+
+    private:
+
+        std::array<duration_type, execution_phase_count> m_durations;
+    };
+
+    /**
+     * Adds the time spent in its scope to a phase of a timer.
+     */
+    class scoped_phase
+    {
+    public:
+
+        scoped_phase(phase_timer& timer, execution_phase phase);
+        ~scoped_phase();
+
+        scoped_phase(const scoped_phase&) = delete;
+        scoped_phase& operator=(const scoped_phase&) = delete;
+
+        // Ends the phase before the end of the scope
+        void stop();
+
+    private:
+
+        phase_timer& m_timer;
+        execution_phase m_phase;
+        phase_timer::clock_type::time_point m_start;
+        bool m_running;
+    };
+
+    /**
+     * Cumulative per-phase histograms of the executions of a session,
+     * with power of two buckets in microseconds.
+     */
+    class phase_histograms
+    {
+    public:
+
+        phase_histograms();
+
+        void record(const phase_timer& timer);
+        nl::json to_json() const;
+
+    private:
+
+        static constexpr std::size_t bucket_count = 40;
+
+        struct histogram
+        {
+            std::size_t m_count = 0;
+            phase_timer::duration_type m_total = phase_timer::duration_type::zero();
+            phase_timer::duration_type m_max = phase_timer::duration_type::zero();
+            std::array<std::size_t, bucket_count> m_buckets;
+        };
+
+        mutable std::mutex m_mutex;
+        std::array<histogram, execution_phase_count> m_histograms;
+    };
+}
+
+#endif
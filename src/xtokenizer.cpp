@@ -0,0 +1,628 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xcell_classifier.hpp"
+#include "xtokenizer.hpp"
+
+namespace xrob
+{
+    namespace
+    {
+        struct cell_range
+        {
+            std::size_t m_begin;
+            std::size_t m_end;
+        };
+
+        bool is_separator_start(const char* line, std::size_t size, std::size_t i)
+        {
+            return line[i] == '\t' || (line[i] == ' ' && i + 1 < size && (line[i + 1] == ' ' || line[i + 1] == '\t'));
+        }
+
+        // Cells are separated by a tab or by two spaces or more
+        std::vector<cell_range> split_cells(const char* line, std::size_t size)
+        {
+            std::vector<cell_range> cells;
+            std::size_t pos = 0;
+            while (pos < size)
+            {
+                while (pos < size && (line[pos] == ' ' || line[pos] == '\t'))
+                {
+                    ++pos;
+                }
+                if (pos == size)
+                {
+                    break;
+                }
+
+                std::size_t end = pos;
+                while (end < size && !is_separator_start(line, size, end))
+                {
+                    ++end;
+                }
+                // A single trailing space is not part of the cell
+                std::size_t cell_end = end;
+                while (cell_end > pos && line[cell_end - 1] == ' ')
+                {
+                    --cell_end;
+                }
+                cells.push_back({pos, cell_end});
+                pos = end;
+            }
+            return cells;
+        }
+
+        bool cell_equals(const char* line, const cell_range& cell, const char* value)
+        {
+            std::size_t size = std::strlen(value);
+            return cell.m_end - cell.m_begin == size && std::equal(line + cell.m_begin, line + cell.m_end, value);
+        }
+
+        std::string normalized_cell(const char* line, const cell_range& cell)
+        {
+            std::string res;
+            for (std::size_t i = cell.m_begin; i < cell.m_end; ++i)
+            {
+                if (line[i] != ' ' && line[i] != '_' && line[i] != '[' && line[i] != ']')
+                {
+                    res.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(line[i]))));
+                }
+            }
+            return res;
+        }
+
+        bool is_assignment(const char* line, const cell_range& cell)
+        {
+            std::size_t end = cell.m_end;
+            while (end > cell.m_begin && (line[end - 1] == '=' || line[end - 1] == ' '))
+            {
+                --end;
+            }
+            return end - cell.m_begin >= 3 && std::strchr("$@&", line[cell.m_begin]) != nullptr &&
+                   line[cell.m_begin + 1] == '{' && line[end - 1] == '}';
+        }
+
+        // End of the variable reference starting at begin, item accesses
+        // included, or 0 when there is no complete reference there
+        std::size_t find_variable_end(const char* line, std::size_t begin, std::size_t end)
+        {
+            if (begin + 1 >= end || std::strchr("$@&%", line[begin]) == nullptr || line[begin + 1] != '{')
+            {
+                return 0;
+            }
+
+            char open = '{';
+            char close = '}';
+            std::size_t depth = 0;
+            std::size_t reference_end = 0;
+            std::size_t pos = begin + 1;
+            while (pos < end)
+            {
+                if (line[pos] == '\\')
+                {
+                    pos += 2;
+                    continue;
+                }
+                if (line[pos] == open)
+                {
+                    ++depth;
+                }
+                else if (line[pos] == close && --depth == 0)
+                {
+                    reference_end = pos + 1;
+                    // Item accesses, as in ${list}[0][key]
+                    if (reference_end < end && line[reference_end] == '[')
+                    {
+                        open = '[';
+                        close = ']';
+                    }
+                    else
+                    {
+                        return reference_end;
+                    }
+                }
+                ++pos;
+            }
+            // An unterminated item access is not part of the reference
+            return reference_end;
+        }
+
+        // Settings taking a keyword as first argument
+        bool takes_keyword(const std::string& setting)
+        {
+            static const char* settings[] = {
+                "setup", "teardown", "template",
+                "suitesetup", "suiteteardown", "testsetup", "testteardown",
+                "tasksetup", "taskteardown", "testtemplate", "tasktemplate"
+            };
+            return std::find_if(std::begin(settings), std::end(settings), [&setting](const char* s)
+            {
+                return setting == s;
+            }) != std::end(settings);
+        }
+
+        class line_tokenizer
+        {
+        public:
+
+            line_tokenizer(const char* line, std::size_t offset, std::size_t line_number, std::vector<token>& tokens)
+                : p_line(line)
+                , m_offset(offset)
+                , m_line_number(line_number)
+                , m_tokens(tokens)
+            {
+            }
+
+            void push(token_kind kind, const cell_range& cell)
+            {
+                m_tokens.push_back({kind, m_offset + cell.m_begin, cell.m_end - cell.m_begin, m_line_number});
+            }
+
+            // Returns the kind expected for a continuation of the statement
+            token_kind statement(const std::vector<cell_range>& cells, std::size_t i, line_state& state)
+            {
+                const char* line = p_line;
+                if (i == cells.size())
+                {
+                    return token_kind::argument;
+                }
+
+                const cell_range& first = cells[i];
+                if (line[first.m_begin] == '[' && line[first.m_end - 1] == ']')
+                {
+                    push(token_kind::setting, first);
+                    return call(cells, i + 1, takes_keyword(normalized_cell(line, first)));
+                }
+
+                if (cell_equals(line, first, "FOR"))
+                {
+                    push(token_kind::control, first);
+                    ++state.m_block_depth;
+                    bool in_values = false;
+                    for (std::size_t j = i + 1; j < cells.size(); ++j)
+                    {
+                        bool is_in = normalized_cell(line, cells[j]).compare(0, 2, "in") == 0 &&
+                                     line[cells[j].m_begin] == 'I';
+                        if (!in_values && is_in)
+                        {
+                            push(token_kind::control, cells[j]);
+                            in_values = true;
+                        }
+                        else
+                        {
+                            if (in_values)
+                            {
+                                push_argument(cells[j]);
+                            }
+                            else
+                            {
+                                push(token_kind::variable, cells[j]);
+                            }
+                        }
+                    }
+                    return token_kind::argument;
+                }
+
+                if (cell_equals(line, first, "WHILE") || cell_equals(line, first, "TRY"))
+                {
+                    push(token_kind::control, first);
+                    ++state.m_block_depth;
+                    return arguments(cells, i + 1);
+                }
+
+                if (cell_equals(line, first, "END"))
+                {
+                    push(token_kind::control, first);
+                    if (state.m_block_depth != 0)
+                    {
+                        --state.m_block_depth;
+                    }
+                    return arguments(cells, i + 1);
+                }
+
+                if (cell_equals(line, first, "IF"))
+                {
+                    // Block IF only holds its condition, inline IF runs keywords
+                    if (cells.size() - i <= 2)
+                    {
+                        ++state.m_block_depth;
+                    }
+                    return conditional(cells, i);
+                }
+
+                if (cell_equals(line, first, "ELSE IF") || cell_equals(line, first, "ELSE"))
+                {
+                    return conditional(cells, i);
+                }
+
+                if (cell_equals(line, first, "EXCEPT") || cell_equals(line, first, "FINALLY") ||
+                    cell_equals(line, first, "BREAK") || cell_equals(line, first, "CONTINUE") ||
+                    cell_equals(line, first, "RETURN"))
+                {
+                    push(token_kind::control, first);
+                    for (std::size_t j = i + 1; j < cells.size(); ++j)
+                    {
+                        if (cell_equals(line, cells[j], "AS"))
+                        {
+                            push(token_kind::control, cells[j]);
+                        }
+                        else
+                        {
+                            push_argument(cells[j]);
+                        }
+                    }
+                    return token_kind::argument;
+                }
+
+                while (i < cells.size() && is_assignment(line, cells[i]))
+                {
+                    push(token_kind::variable, cells[i]);
+                    ++i;
+                }
+
+                // Inline IF assigning its result
+                if (i < cells.size() && cell_equals(line, cells[i], "IF"))
+                {
+                    return conditional(cells, i);
+                }
+                return call(cells, i, true);
+            }
+
+            token_kind call(const std::vector<cell_range>& cells, std::size_t i, bool has_keyword)
+            {
+                if (has_keyword)
+                {
+                    if (i == cells.size())
+                    {
+                        return token_kind::keyword;
+                    }
+                    push(token_kind::keyword, cells[i]);
+                    ++i;
+                }
+                return arguments(cells, i);
+            }
+
+            token_kind arguments(const std::vector<cell_range>& cells, std::size_t i)
+            {
+                for (; i < cells.size(); ++i)
+                {
+                    push_argument(cells[i]);
+                }
+                return token_kind::argument;
+            }
+
+            // Variables referenced in the argument are emitted as variable tokens
+            void push_argument(const cell_range& cell)
+            {
+                const char* line = p_line;
+                std::size_t begin = cell.m_begin;
+                std::size_t pos = cell.m_begin;
+                while (pos < cell.m_end)
+                {
+                    if (line[pos] == '\\')
+                    {
+                        pos = std::min(pos + 2, cell.m_end);
+                        continue;
+                    }
+
+                    std::size_t end = find_variable_end(line, pos, cell.m_end);
+                    if (end == 0)
+                    {
+                        ++pos;
+                        continue;
+                    }
+                    if (pos > begin)
+                    {
+                        push(token_kind::argument, {begin, pos});
+                    }
+                    push(token_kind::variable, {pos, end});
+                    begin = pos = end;
+                }
+                if (begin < cell.m_end)
+                {
+                    push(token_kind::argument, {begin, cell.m_end});
+                }
+            }
+
+            // IF, ELSE IF and ELSE branches, possibly inline
+            token_kind conditional(const std::vector<cell_range>& cells, std::size_t i)
+            {
+                const char* line = p_line;
+                while (i < cells.size())
+                {
+                    bool has_condition = !cell_equals(line, cells[i], "ELSE");
+                    push(token_kind::control, cells[i]);
+                    ++i;
+                    if (has_condition && i < cells.size())
+                    {
+                        push_argument(cells[i]);
+                        ++i;
+                    }
+                    if (i == cells.size())
+                    {
+                        break;
+                    }
+
+                    push(token_kind::keyword, cells[i]);
+                    ++i;
+                    while (i < cells.size() && !cell_equals(line, cells[i], "ELSE IF") && !cell_equals(line, cells[i], "ELSE"))
+                    {
+                        push_argument(cells[i]);
+                        ++i;
+                    }
+                }
+                return token_kind::argument;
+            }
+
+        private:
+
+            const char* p_line;
+            std::size_t m_offset;
+            std::size_t m_line_number;
+            std::vector<token>& m_tokens;
+        };
+    }
+
+    bool operator==(const line_state& lhs, const line_state& rhs)
+    {
+        return lhs.m_section == rhs.m_section &&
+               lhs.m_block_depth == rhs.m_block_depth &&
+               lhs.m_continued == rhs.m_continued;
+    }
+
+    bool operator!=(const line_state& lhs, const line_state& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    void tokenize_line(const char* line,
+                       std::size_t size,
+                       std::size_t offset,
+                       std::size_t line_number,
+                       line_state& state,
+                       std::vector<token>& tokens)
+    {
+        while (size > 0 && line[size - 1] == '\r')
+        {
+            --size;
+        }
+
+        line_tokenizer tokenizer(line, offset, line_number, tokens);
+
+        if (size > 0 && line[0] == '*')
+        {
+            std::size_t end = size;
+            while (end > 0 && (line[end - 1] == ' ' || line[end - 1] == '\t'))
+            {
+                --end;
+            }
+            tokenizer.push(token_kind::header, {0, end});
+            state.m_section = get_section_kind(cell_view(line, size));
+            state.m_block_depth = 0;
+            state.m_continued = token_kind::argument;
+            return;
+        }
+
+        std::vector<cell_range> cells = split_cells(line, size);
+        if (cells.empty())
+        {
+            return;
+        }
+
+        if (state.m_section == section_kind::comments || state.m_section == section_kind::unknown)
+        {
+            tokenizer.push(token_kind::comment, {cells.front().m_begin, cells.back().m_end});
+            return;
+        }
+
+        // Comments run until the end of the line
+        auto comment = std::find_if(cells.begin(), cells.end(), [line](const cell_range& cell)
+        {
+            return line[cell.m_begin] == '#';
+        });
+        if (comment != cells.end())
+        {
+            cell_range range = {comment->m_begin, cells.back().m_end};
+            cells.erase(comment, cells.end());
+            if (cells.empty())
+            {
+                tokenizer.push(token_kind::comment, range);
+                return;
+            }
+            // Emitted after the other tokens of the line to keep the offsets sorted
+            tokenize_line(line, range.m_begin, offset, line_number, state, tokens);
+            tokenizer.push(token_kind::comment, range);
+            return;
+        }
+
+        std::size_t i = 0;
+        if (cell_equals(line, cells.front(), "..."))
+        {
+            tokenizer.push(token_kind::continuation, cells.front());
+            i = 1;
+            if (i < cells.size() && state.m_continued == token_kind::keyword)
+            {
+                state.m_continued = tokenizer.call(cells, i, true);
+            }
+            else
+            {
+                tokenizer.arguments(cells, i);
+            }
+            return;
+        }
+
+        bool indented = line[0] == ' ' || line[0] == '\t';
+        switch (state.m_section)
+        {
+            case section_kind::settings:
+            {
+                tokenizer.push(token_kind::setting, cells.front());
+                state.m_continued = tokenizer.call(cells, 1, takes_keyword(normalized_cell(line, cells.front())));
+                break;
+            }
+            case section_kind::variables:
+            {
+                tokenizer.push(token_kind::variable, cells.front());
+                state.m_continued = tokenizer.arguments(cells, 1);
+                break;
+            }
+            default:
+            {
+                if (!indented && state.m_section != section_kind::none)
+                {
+                    // A new test, task or keyword, possibly followed by its first step
+                    tokenizer.push(token_kind::name, cells.front());
+                    state.m_block_depth = 0;
+                    i = 1;
+                }
+                state.m_continued = tokenizer.statement(cells, i, state);
+                break;
+            }
+        }
+    }
+
+    void tokenizer::tokenize(const std::string& text)
+    {
+        m_lines.clear();
+        m_tokens.clear();
+
+        line_state state;
+        std::size_t pos = 0;
+        while (true)
+        {
+            std::size_t end = text.find('\n', pos);
+            std::size_t line_end = end == std::string::npos ? text.size() : end;
+            m_lines.push_back({pos, state, m_tokens.size()});
+            tokenize_line(text.data() + pos, line_end - pos, pos, m_lines.size() - 1, state, m_tokens);
+            if (end == std::string::npos)
+            {
+                break;
+            }
+            pos = end + 1;
+        }
+        m_end_state = state;
+    }
+
+    void tokenizer::retokenize(const std::string& text,
+                               std::size_t offset,
+                               std::size_t removed_length,
+                               std::size_t inserted_length)
+    {
+        if (m_lines.empty())
+        {
+            tokenize(text);
+            return;
+        }
+
+        // First line touched by the edit, the lines before are kept as is
+        auto first = std::upper_bound(m_lines.begin(), m_lines.end(), offset, [](std::size_t value, const line_entry& entry)
+        {
+            return value < entry.m_begin;
+        });
+        std::size_t first_line = static_cast<std::size_t>(first - m_lines.begin()) - 1;
+
+        std::vector<line_entry> old_lines = std::move(m_lines);
+        std::vector<token> old_tokens = std::move(m_tokens);
+
+        m_lines.assign(old_lines.begin(), old_lines.begin() + static_cast<std::ptrdiff_t>(first_line));
+        m_tokens.assign(old_tokens.begin(), old_tokens.begin() + static_cast<std::ptrdiff_t>(old_lines[first_line].m_first_token));
+
+        // Old lines starting after the edit have unchanged content, shifted by the edit
+        std::size_t old_edit_end = offset + removed_length;
+        std::size_t new_edit_end = offset + inserted_length;
+        std::size_t old_line = first_line + 1;
+
+        line_state state = old_lines[first_line].m_state;
+        std::size_t pos = old_lines[first_line].m_begin;
+        while (true)
+        {
+            if (pos > new_edit_end)
+            {
+                std::size_t old_pos = pos - inserted_length + removed_length;
+                while (old_line < old_lines.size() && old_lines[old_line].m_begin < old_pos)
+                {
+                    ++old_line;
+                }
+
+                // Same content and same starting state, the remaining tokens are unchanged
+                if (old_line < old_lines.size() && old_lines[old_line].m_begin == old_pos &&
+                    old_pos > old_edit_end && old_lines[old_line].m_state == state)
+                {
+                    std::size_t new_line = m_lines.size();
+                    std::size_t token_shift = m_tokens.size();
+                    std::size_t old_first_token = old_lines[old_line].m_first_token;
+                    for (std::size_t j = old_line; j < old_lines.size(); ++j)
+                    {
+                        line_entry entry = old_lines[j];
+                        entry.m_begin = entry.m_begin - old_pos + pos;
+                        entry.m_first_token = entry.m_first_token - old_first_token + token_shift;
+                        m_lines.push_back(entry);
+                    }
+                    for (std::size_t j = old_first_token; j < old_tokens.size(); ++j)
+                    {
+                        token tok = old_tokens[j];
+                        tok.m_offset = tok.m_offset - old_pos + pos;
+                        tok.m_line = tok.m_line - old_line + new_line;
+                        m_tokens.push_back(tok);
+                    }
+                    return;
+                }
+            }
+
+            std::size_t end = text.find('\n', pos);
+            std::size_t line_end = end == std::string::npos ? text.size() : end;
+            m_lines.push_back({pos, state, m_tokens.size()});
+            tokenize_line(text.data() + pos, line_end - pos, pos, m_lines.size() - 1, state, m_tokens);
+            if (end == std::string::npos)
+            {
+                break;
+            }
+            pos = end + 1;
+        }
+        m_end_state = state;
+    }
+
+    const std::vector<token>& tokenizer::tokens() const
+    {
+        return m_tokens;
+    }
+
+    std::size_t tokenizer::find_token(std::size_t offset) const
+    {
+        auto it = std::lower_bound(m_tokens.begin(), m_tokens.end(), offset, [](const token& tok, std::size_t value)
+        {
+            return tok.m_offset + tok.m_length <= value;
+        });
+        return static_cast<std::size_t>(it - m_tokens.begin());
+    }
+
+    std::size_t tokenizer::line_count() const
+    {
+        return m_lines.size();
+    }
+
+    const line_state& tokenizer::get_line_state(std::size_t line) const
+    {
+        return m_lines[line].m_state;
+    }
+
+    const line_state& tokenizer::get_end_state() const
+    {
+        return m_end_state;
+    }
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_TOKENIZER_HPP
+#define XROB_TOKENIZER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "xcell_classifier.hpp"
+
+namespace xrob
+{
+    enum class token_kind
+    {
+        header,
+        comment,
+        // Name of a test, task or keyword definition
+        name,
+        // Setting name, in the settings section or between brackets
+        setting,
+        // Variable definition or assignment, or variable referenced in an argument
+        variable,
+        keyword,
+        argument,
+        // FOR, IF, END, ... markers
+        control,
+        continuation
+    };
+
+    struct token
+    {
+        token_kind m_kind;
+        // Byte offset in the document
+        std::size_t m_offset;
+        std::size_t m_length;
+        std::size_t m_line;
+    };
+
+    /**
+     * State of the tokenizer at the beginning of a line, it only depends
+     * on the previous lines.
+     */
+    struct line_state
+    {
+        section_kind m_section = section_kind::none;
+        // Number of open FOR, WHILE, IF and TRY blocks
+        std::size_t m_block_depth = 0;
+        // Kind of the token continued by a "..." line
+        token_kind m_continued = token_kind::argument;
+    };
+
+    bool operator==(const line_state& lhs, const line_state& rhs);
+    bool operator!=(const line_state& lhs, const line_state& rhs);
+
+    /**
+     * Tokenizes a line of the robot plain text format. Lines are fed one
+     * after the other, state is updated for the next line.
+     */
+    void tokenize_line(const char* line,
+                       std::size_t size,
+                       std::size_t offset,
+                       std::size_t line_number,
+                       line_state& state,
+                       std::vector<token>& tokens);
+
+    /**
+     * Tokens of a robot document, with an incremental update after edits:
+     * only the lines from the edited one up to the first line whose state
+     * is unchanged are tokenized again.
+     */
+    class tokenizer
+    {
+    public:
+
+        void tokenize(const std::string& text);
+
+        // text is the new content, where [offset, offset + removed_length) of the
+        // previous content has been replaced with inserted_length characters
+        void retokenize(const std::string& text,
+                        std::size_t offset,
+                        std::size_t removed_length,
+                        std::size_t inserted_length);
+
+        const std::vector<token>& tokens() const;
+
+        // Index of the first token at or after offset
+        std::size_t find_token(std::size_t offset) const;
+
+        std::size_t line_count() const;
+        const line_state& get_line_state(std::size_t line) const;
+        const line_state& get_end_state() const;
+
+    private:
+
+        struct line_entry
+        {
+            std::size_t m_begin;
+            line_state m_state;
+            std::size_t m_first_token;
+        };
+
+        std::vector<line_entry> m_lines;
+        std::vector<token> m_tokens;
+        // State after the last line
+        line_state m_end_state;
+    };
+}
+
+#endif
@@ -0,0 +1,223 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus/xsystem.hpp"
+
+#include "xinternal_utils.hpp"
+#include "xtrace.hpp"
+
+namespace nl = nlohmann;
+
+namespace xrob
+{
+    namespace
+    {
+        using clock_type = std::chrono::steady_clock;
+
+        struct trace_event
+        {
+            char m_name[trace_span::max_size + 1];
+            char m_phase;
+            // Microseconds since the start of the kernel
+            std::int64_t m_timestamp;
+        };
+
+        // Written by its thread only, read by dump_trace
+        class trace_buffer
+        {
+        public:
+
+            trace_buffer(std::size_t id, std::size_t capacity)
+                : m_id(id)
+                , m_thread_name(nullptr)
+                , m_events(std::max(capacity, std::size_t(1)))
+                , m_count(0)
+            {
+            }
+
+            void record(const char* name, char phase, clock_type::time_point time, clock_type::time_point origin)
+            {
+                std::uint64_t count = m_count.load(std::memory_order_relaxed);
+                trace_event& event = m_events[static_cast<std::size_t>(count % m_events.size())];
+                std::strncpy(event.m_name, name, trace_span::max_size);
+                event.m_name[trace_span::max_size] = '\0';
+                event.m_phase = phase;
+                event.m_timestamp = std::chrono::duration_cast<std::chrono::microseconds>(time - origin).count();
+                m_count.store(count + 1, std::memory_order_release);
+            }
+
+            void dump(nl::json& events, int pid) const
+            {
+                const char* thread_name = m_thread_name.load();
+                if (thread_name != nullptr)
+                {
+                    events.push_back({
+                        {"name", "thread_name"}, {"ph", "M"}, {"pid", pid}, {"tid", m_id},
+                        {"args", {{"name", thread_name}}}
+                    });
+                }
+
+                // The oldest events are overwritten once the buffer is full
+                std::uint64_t size = m_events.size();
+                std::uint64_t count = m_count.load(std::memory_order_acquire);
+                std::uint64_t first = count > size ? count - size : 0;
+                std::vector<trace_event> copy;
+                copy.reserve(static_cast<std::size_t>(count - first));
+                for (std::uint64_t i = first; i < count; ++i)
+                {
+                    copy.push_back(m_events[static_cast<std::size_t>(i % size)]);
+                }
+
+                // Drop the events the thread overwrote while they were copied
+                std::uint64_t last = m_count.load(std::memory_order_acquire);
+                std::uint64_t valid = last > size ? last - size + 1 : 0;
+                for (std::uint64_t i = std::max(first, valid); i < count; ++i)
+                {
+                    const trace_event& event = copy[static_cast<std::size_t>(i - first)];
+                    events.push_back({
+                        {"name", event.m_name}, {"ph", std::string(1, event.m_phase)},
+                        {"ts", event.m_timestamp}, {"pid", pid}, {"tid", m_id}
+                    });
+                }
+            }
+
+            std::size_t m_id;
+            std::atomic<const char*> m_thread_name;
+
+        private:
+
+            std::vector<trace_event> m_events;
+            std::atomic<std::uint64_t> m_count;
+        };
+
+        // Threads are named when they start, possibly before tracing is
+        // enabled: the name is kept until the buffer of the thread is created
+        const char*& get_thread_name()
+        {
+            thread_local const char* name = nullptr;
+            return name;
+        }
+
+        struct tracer
+        {
+            tracer()
+                : m_origin(clock_type::now())
+                , m_enabled(!get_env_string("XROBOT_TRACE", "").empty())
+                , m_capacity(get_env_size("XROBOT_TRACE_BUFFER_SIZE", 16384))
+            {
+            }
+
+            trace_buffer& get_buffer()
+            {
+                thread_local trace_buffer* p_buffer = nullptr;
+                if (p_buffer == nullptr)
+                {
+                    // Buffers outlive their thread so that they can still be dumped
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_buffers.emplace_back(new trace_buffer(m_buffers.size() + 1, m_capacity));
+                    p_buffer = m_buffers.back().get();
+                    p_buffer->m_thread_name = get_thread_name();
+                }
+                return *p_buffer;
+            }
+
+            clock_type::time_point m_origin;
+            std::atomic<bool> m_enabled;
+            std::size_t m_capacity;
+            std::mutex m_mutex;
+            std::vector<std::unique_ptr<trace_buffer>> m_buffers;
+        };
+
+        tracer& get_tracer()
+        {
+            static tracer instance;
+            return instance;
+        }
+    }
+
+    bool is_trace_enabled()
+    {
+        return get_tracer().m_enabled.load(std::memory_order_relaxed);
+    }
+
+    void set_trace_enabled(bool enabled)
+    {
+        get_tracer().m_enabled = enabled;
+    }
+
+    void set_trace_thread_name(const char* name)
+    {
+        get_thread_name() = name;
+        if (is_trace_enabled())
+        {
+            get_tracer().get_buffer().m_thread_name = name;
+        }
+    }
+
+    nl::json dump_trace()
+    {
+        tracer& instance = get_tracer();
+        int pid = xeus::get_current_pid();
+
+        nl::json events = nl::json::array();
+        std::lock_guard<std::mutex> lock(instance.m_mutex);
+        for (const auto& buffer : instance.m_buffers)
+        {
+            buffer->dump(events, pid);
+        }
+        return {{"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}};
+    }
+
+    bool write_trace(const std::string& path)
+    {
+        std::ofstream out(path);
+        out << dump_trace().dump();
+        return static_cast<bool>(out);
+    }
+
+    trace_span::trace_span(const char* name)
+        : m_active(is_trace_enabled())
+    {
+        if (m_active)
+        {
+            std::strncpy(m_name, name, max_size);
+            m_name[max_size] = '\0';
+            tracer& instance = get_tracer();
+            instance.get_buffer().record(m_name, 'B', clock_type::now(), instance.m_origin);
+        }
+    }
+
+    trace_span::trace_span(const std::string& name)
+        : trace_span(name.c_str())
+    {
+    }
+
+    trace_span::~trace_span()
+    {
+        if (m_active)
+        {
+            tracer& instance = get_tracer();
+            instance.get_buffer().record(m_name, 'E', clock_type::now(), instance.m_origin);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_TRACE_HPP
+#define XROB_TRACE_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "nlohmann/json.hpp"
+
+namespace nl = nlohmann;
+
+namespace xrob
+{
+    /**
+     * Opt-in timeline of the kernel threads. Spans are recorded in a ring
+     * buffer per thread, written without locks by the owning thread, and
+     * dumped in the Chrome trace event format (chrome://tracing, Perfetto).
+     *
+     * Tracing is enabled when XROBOT_TRACE is set, the trace is written to
+     * the file it names at shutdown. XROBOT_TRACE_BUFFER_SIZE is the number
+     * of events kept per thread.
+     */
+    bool is_trace_enabled();
+    void set_trace_enabled(bool enabled);
+
+    // Name of the calling thread in the trace, it must outlive the program.
+    // Threads are named once, where they start.
+    void set_trace_thread_name(const char* name);
+
+    // Events recorded while dumping may be missing from the dump
+    nl::json dump_trace();
+    bool write_trace(const std::string& path);
+
+    /**
+     * Records a begin event when constructed and the matching end event
+     * when destroyed. Names longer than max_size are truncated.
+     */
+    class trace_span
+    {
+    public:
+
+        static constexpr std::size_t max_size = 47;
+
+        explicit trace_span(const char* name);
+        explicit trace_span(const std::string& name);
+        ~trace_span();
+
+        trace_span(const trace_span&) = delete;
+        trace_span& operator=(const trace_span&) = delete;
+
+    private:
+
+        bool m_active;
+        char m_name[max_size + 1];
+    };
+}
+
+#endif
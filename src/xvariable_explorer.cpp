@@ -0,0 +1,179 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+
+// This must be included BEFORE pybind
+// otherwise it fails to build on Windows
+// because of the redefinition of snprintf
+#include "nlohmann/json.hpp"
+
+#include "pybind11_json/pybind11_json.hpp"
+
+#include "pybind11/pybind11.h"
+
+#include "xinternal_utils.hpp"
+#include "xvariable_explorer.hpp"
+
+namespace nl = nlohmann;
+namespace py = pybind11;
+
+namespace xrob
+{
+    namespace
+    {
+        const char* variable_explorer_py = R"py(
+import itertools
+import reprlib
+from collections.abc import Mapping
+
+
+class VariableExplorer:
+
+    def __init__(self, reference_base, preview_length):
+        self.reference_base = reference_base
+        self.preview_length = preview_length
+        self.repr = reprlib.Repr()
+        self.repr.maxstring = preview_length
+        self.repr.maxother = preview_length
+        self.handles = []
+
+    def clear(self):
+        self.handles = []
+
+    def owns(self, reference):
+        return self.reference_base <= reference < self.reference_base + len(self.handles)
+
+    def add_handle(self, value):
+        self.handles.append(value)
+        return self.reference_base + len(self.handles) - 1
+
+    def preview(self, value):
+        try:
+            text = self.repr.repr(value)
+        except Exception as e:
+            text = "<unrepresentable %s: %s>" % (type(value).__name__, e)
+        if len(text) > self.preview_length:
+            text = text[:self.preview_length - 3] + "..."
+        return text
+
+    def get_children(self, value):
+        # (named, indexed) counts, and an iterator over the (name, value) pairs
+        if isinstance(value, (str, bytes, bytearray)):
+            return None
+        if isinstance(value, Mapping):
+            return len(value), 0, ((str(key), child) for key, child in value.items())
+        if isinstance(value, (list, tuple, set, frozenset)):
+            return 0, len(value), (("[%d]" % index, child) for index, child in enumerate(value))
+        attributes = getattr(value, "__dict__", None)
+        if isinstance(attributes, dict) and not isinstance(value, type):
+            return len(attributes), 0, ((key, child) for key, child in attributes.items())
+        return None
+
+    def make_variable(self, name, value, preview=None):
+        variable = {
+            "name": name,
+            "value": self.preview(value) if preview is None else preview,
+            "type": type(value).__name__,
+            "variablesReference": 0,
+        }
+        children = self.get_children(value)
+        if children is not None and children[0] + children[1] > 0:
+            # Children are only listed when the frontend expands the variable
+            variable["variablesReference"] = self.add_handle(value)
+            variable["namedVariables"] = children[0]
+            variable["indexedVariables"] = children[1]
+        return variable
+
+    def get_robot_scopes(self):
+        try:
+            from robot.running.context import EXECUTION_CONTEXTS
+        except ImportError:
+            return []
+        context = EXECUTION_CONTEXTS.current
+        if context is None:
+            return []
+
+        scopes = context.variables
+        candidates = [
+            ("Global", getattr(scopes, "_global", None)),
+            ("Suite", getattr(scopes, "_suite", None)),
+            ("Test", getattr(scopes, "_test", None)),
+            ("Local", getattr(scopes, "current", None)),
+        ]
+        result = []
+        for name, scope in candidates:
+            if scope is None or any(scope is other for _, other in result):
+                continue
+            result.append((name, scope))
+        return [(name, scope.as_dict(decoration=True)) for name, scope in result]
+
+    def inspect(self, python_globals):
+        self.clear()
+        scopes = self.get_robot_scopes()
+        scopes.append(("Python", {
+            key: value for key, value in python_globals.items() if not key.startswith("__")
+        }))
+        return [
+            self.make_variable(name, variables, "%d variables" % len(variables))
+            for name, variables in scopes
+        ]
+
+    def variables(self, reference, start, count):
+        value = self.handles[reference - self.reference_base]
+        children = self.get_children(value)
+        if children is None:
+            return []
+        stop = start + count
+        if isinstance(value, (list, tuple)):
+            # Sequences are sliced instead of iterated up to the page
+            return [self.make_variable("[%d]" % index, value[index]) for index in range(start, min(stop, len(value)))]
+        return [self.make_variable(name, child) for name, child in itertools.islice(children[2], start, stop)]
+)py";
+
+        py::object get_explorer()
+        {
+            // The explorer holds the handles of the expanded variables, it lives
+            // in the scope of its code
+            py::dict& scope = get_embedded_scope(variable_explorer_py);
+            if (!scope.contains("explorer"))
+            {
+                scope["explorer"] = scope["VariableExplorer"](explorer_reference_base, max_preview_length);
+            }
+            return scope["explorer"];
+        }
+    }
+
+    nl::json inspect_variables()
+    {
+        return get_explorer().attr("inspect")(py::globals());
+    }
+
+    bool is_explorer_reference(int reference)
+    {
+        return reference >= explorer_reference_base;
+    }
+
+    nl::json get_explorer_variables(int reference, std::size_t start, std::size_t count)
+    {
+        py::object explorer = get_explorer();
+        if (!explorer.attr("owns")(reference).cast<bool>())
+        {
+            // Handle from a previous inspection
+            return nl::json::array();
+        }
+
+        if (count == 0 || count > max_variables_page)
+        {
+            count = max_variables_page;
+        }
+        return explorer.attr("variables")(reference, start, count);
+    }
+}
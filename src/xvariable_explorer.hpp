@@ -0,0 +1,45 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XROB_VARIABLE_EXPLORER_HPP
+#define XROB_VARIABLE_EXPLORER_HPP
+
+#include <cstddef>
+
+#include "nlohmann/json.hpp"
+
+namespace nl = nlohmann;
+
+namespace xrob
+{
+    // Handles of the variable explorer start far above the ones of the
+    // robot debug adapter so that both can be told apart
+    constexpr int explorer_reference_base = 1 << 30;
+    constexpr std::size_t max_variables_page = 1000;
+    constexpr std::size_t max_preview_length = 256;
+
+    /**
+     * Lists the robot variable scopes (global, suite, test and local)
+     * of the current execution context and the Python globals. Each
+     * scope gets a variablesReference handle, the handles of the previous
+     * call are invalidated. Values are size capped previews.
+     *
+     * The explorer functions must be called with the GIL held.
+     */
+    nl::json inspect_variables();
+
+    bool is_explorer_reference(int reference);
+
+    // Children of a handle, one page at a time. Containers among
+    // them get their own handle and are only expanded on request.
+    nl::json get_explorer_variables(int reference, std::size_t start, std::size_t count);
+}
+
+#endif
@@ -29,6 +29,33 @@ class XeusRobotTests(jupyter_kernel_test.KernelTests):
         {'text': '%%python module test\nfrom time import s', 'matches': {'sleep', 'strftime', 'strptime', 'struct_time'}},
     ]
 
+    complete_code_samples = [
+        '*** Tasks ***\nMy Task\n    Log  Hello\n\n',
+        '*** Settings ***\nLibrary  String',
+        '%%python module test\ndef f():\n    pass\n\n',
+    ]
+
+    incomplete_code_samples = [
+        '*** Tasks ***\nMy Task',
+        '*** Tasks ***\nMy Task\n    FOR  ${i}  IN RANGE  3\n        Log  ${i}\n\n',
+        '%%python module test\ndef f():',
+    ]
+
+    invalid_code_samples = [
+        '*** Tasks ***\nMy Task\n    END\n\n',
+    ]
+
+    def test_xrobot_keyword_completion_after_definition(self):
+        # Keywords defined by an executed cell are indexed for completion
+        self.flush_channels()
+        reply, _ = self.execute_helper(code='*** Keywords ***\nMy Custom Keyword\n    Log  Hello\n')
+        self.assertEqual(reply['content']['status'], 'ok')
+
+        self.kc.complete('*** Tasks ***\nTask\n    My Custom Key')
+        reply = self.get_non_kernel_info_reply(timeout=jupyter_kernel_test.TIMEOUT)
+        self.assertEqual(reply['msg_type'], 'complete_reply')
+        self.assertIn('My Custom Keyword', reply['content']['matches'])
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,101 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "pybind11/embed.h"
+#include "pybind11/pybind11.h"
+
+#include "xresult_summary.hpp"
+
+namespace py = pybind11;
+
+namespace xrob
+{
+    namespace
+    {
+        // Stands for the result suites of robot.api.ExecutionResult
+        const char* make_result_py = R"py(
+from datetime import timedelta
+from types import SimpleNamespace
+
+def test(name, status, message=""):
+    return SimpleNamespace(name=name, status=status, message=message,
+                           elapsed_time=timedelta(milliseconds=5))
+
+def suite(name, tests=(), suites=()):
+    return SimpleNamespace(name=name, tests=list(tests), suites=list(suites),
+                           elapsed_time=timedelta(milliseconds=20))
+
+result = suite("Root", [test("T0", "FAIL", "m0")], [
+    suite("A", [test("T1", "FAIL", "m1"), test("T2", "PASS")], [
+        suite("C", [test("T3", "FAIL", "m3"), test("T4", "SKIP")])
+    ]),
+    suite("B", [test("T5", "FAIL", "m5"), test("T6", "PASS")])
+])
+)py";
+
+        py::object make_result()
+        {
+            // The interpreter lives until the end of the tests
+            static py::scoped_interpreter* interpreter = new py::scoped_interpreter();
+            static_cast<void>(interpreter);
+
+            py::dict scope;
+            py::exec(make_result_py, scope);
+            return scope["result"];
+        }
+    }
+
+    TEST(result_summary, counts)
+    {
+        result_summary summary = summarize_result(make_result(), 10);
+        EXPECT_EQ(summary.m_passed, 2u);
+        EXPECT_EQ(summary.m_failed, 4u);
+        EXPECT_EQ(summary.m_skipped, 1u);
+        EXPECT_EQ(summary.total(), 7u);
+        EXPECT_EQ(summary.m_suites, 4u);
+        EXPECT_DOUBLE_EQ(summary.m_elapsed_ms, 20.);
+    }
+
+    TEST(result_summary, failure_order)
+    {
+        // Depth first, in the order of the suites
+        result_summary summary = summarize_result(make_result(), 10);
+        std::vector<std::string> names;
+        for (const task_failure& failure : summary.m_failures)
+        {
+            names.push_back(failure.m_name);
+        }
+        std::vector<std::string> expected = {"T0", "A.T1", "A.C.T3", "B.T5"};
+        EXPECT_EQ(names, expected);
+        EXPECT_EQ(summary.m_failures[2].m_message, "m3");
+        EXPECT_DOUBLE_EQ(summary.m_failures[2].m_elapsed_ms, 5.);
+    }
+
+    TEST(result_summary, max_failures)
+    {
+        result_summary summary = summarize_result(make_result(), 2);
+        EXPECT_EQ(summary.m_failed, 4u);
+        ASSERT_EQ(summary.m_failures.size(), 2u);
+        EXPECT_EQ(summary.m_failures[1].m_name, "A.T1");
+
+        nl::json json = summary.to_json();
+        EXPECT_EQ(json["failed"], 4);
+        EXPECT_EQ(json["failures"].size(), 2u);
+
+        std::vector<std::string> traceback = get_failure_traceback(summary, "TaskFailure");
+        ASSERT_EQ(traceback.size(), 5u);
+        EXPECT_NE(traceback[3].find("2 more failed task(s)"), std::string::npos);
+    }
+}
@@ -0,0 +1,285 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "nlohmann/json.hpp"
+
+#include "xbreakpoint_index.hpp"
+#include "xcell_classifier.hpp"
+#include "xcompletion_cache.hpp"
+#include "xkeyword_index.hpp"
+
+namespace nl = nlohmann;
+
+namespace xrob
+{
+    namespace
+    {
+        breakpoint_spec make_breakpoint(int line, const std::string& hit_condition = "")
+        {
+            breakpoint_spec spec;
+            spec.m_line = line;
+            spec.m_hit_condition = hit_condition;
+            return spec;
+        }
+
+        std::vector<std::string> get_names(const std::vector<const keyword_entry*>& entries)
+        {
+            std::vector<std::string> names;
+            for (const keyword_entry* entry : entries)
+            {
+                names.push_back(entry->m_name);
+            }
+            return names;
+        }
+
+        std::string get_key(const std::string& code, std::size_t offset, bool whole_token, std::size_t generation = 0)
+        {
+            cell_info cell = classify_cell(code);
+            cursor_info cursor = classify_cursor(cell, code, static_cast<int>(offset));
+            return get_request_key(code, cursor, whole_token, generation);
+        }
+    }
+
+    TEST(hit_condition, exact)
+    {
+        EXPECT_TRUE(check_hit_condition("3", 3));
+        EXPECT_FALSE(check_hit_condition("3", 2));
+        EXPECT_TRUE(check_hit_condition("==3", 3));
+        EXPECT_FALSE(check_hit_condition("==3", 4));
+        EXPECT_TRUE(check_hit_condition(" 3 ", 3));
+    }
+
+    TEST(hit_condition, comparisons)
+    {
+        EXPECT_TRUE(check_hit_condition(">3", 4));
+        EXPECT_FALSE(check_hit_condition(">3", 3));
+        EXPECT_TRUE(check_hit_condition(">=3", 3));
+        EXPECT_FALSE(check_hit_condition(">=3", 2));
+        EXPECT_TRUE(check_hit_condition("<3", 2));
+        EXPECT_FALSE(check_hit_condition("<3", 3));
+        EXPECT_TRUE(check_hit_condition("<=3", 3));
+        EXPECT_FALSE(check_hit_condition("<=3", 4));
+    }
+
+    TEST(hit_condition, modulo)
+    {
+        EXPECT_TRUE(check_hit_condition("%2", 4));
+        EXPECT_FALSE(check_hit_condition("%2", 3));
+        EXPECT_TRUE(check_hit_condition("%0", 3));
+    }
+
+    TEST(hit_condition, invalid)
+    {
+        // Invalid conditions always hold
+        EXPECT_TRUE(check_hit_condition("", 1));
+        EXPECT_TRUE(check_hit_condition("abc", 1));
+        EXPECT_TRUE(check_hit_condition("3x", 1));
+        EXPECT_TRUE(check_hit_condition("=>3", 1));
+        EXPECT_TRUE(check_hit_condition(">", 1));
+    }
+
+    TEST(breakpoint_index, set_and_find)
+    {
+        breakpoint_index index;
+        EXPECT_TRUE(index.empty());
+
+        index.set_breakpoints("suite.robot", {make_breakpoint(3, ">1"), make_breakpoint(5)});
+        EXPECT_FALSE(index.empty());
+
+        breakpoint_spec found;
+        ASSERT_TRUE(index.find_breakpoint("suite.robot", 3, found));
+        EXPECT_EQ(found.m_line, 3);
+        EXPECT_EQ(found.m_hit_condition, ">1");
+        EXPECT_FALSE(index.find_breakpoint("suite.robot", 4, found));
+        EXPECT_FALSE(index.find_breakpoint("other.robot", 3, found));
+    }
+
+    TEST(breakpoint_index, replace)
+    {
+        breakpoint_index index;
+        index.set_breakpoints("suite.robot", {make_breakpoint(3)});
+        index.set_breakpoints("suite.robot", {make_breakpoint(7)});
+
+        breakpoint_spec found;
+        EXPECT_FALSE(index.find_breakpoint("suite.robot", 3, found));
+        EXPECT_TRUE(index.find_breakpoint("suite.robot", 7, found));
+
+        index.set_breakpoints("suite.robot", {});
+        EXPECT_TRUE(index.empty());
+        EXPECT_FALSE(index.find_breakpoint("suite.robot", 7, found));
+    }
+
+    TEST(breakpoint_index, hit_count)
+    {
+        breakpoint_index index;
+        index.set_breakpoints("suite.robot", {make_breakpoint(3)});
+        EXPECT_EQ(index.add_hit("suite.robot", 3), 1u);
+        EXPECT_EQ(index.add_hit("suite.robot", 3), 2u);
+        EXPECT_EQ(index.add_hit("suite.robot", 4), 0u);
+
+        // Replacing the breakpoints of a source starts the counts over
+        index.set_breakpoints("suite.robot", {make_breakpoint(3)});
+        EXPECT_EQ(index.add_hit("suite.robot", 3), 1u);
+    }
+
+    TEST(breakpoint_index, tracing)
+    {
+        breakpoint_index index;
+        EXPECT_FALSE(index.is_tracing_all());
+        index.set_stepping(true);
+        EXPECT_TRUE(index.is_tracing_all());
+        index.set_stepping(false);
+        index.set_break_on_failures(true);
+        EXPECT_TRUE(index.is_tracing_all());
+
+        index.set_breakpoints("suite.robot", {make_breakpoint(3)});
+        index.clear();
+        EXPECT_FALSE(index.is_tracing_all());
+        EXPECT_TRUE(index.empty());
+    }
+
+    TEST(completion_cache, lru)
+    {
+        completion_cache cache(2);
+        cache.insert("a", 1);
+        cache.insert("b", 2);
+
+        // a becomes the most recently used, b is evicted by c
+        ASSERT_NE(cache.find("a"), nullptr);
+        cache.insert("c", 3);
+        EXPECT_EQ(cache.find("b"), nullptr);
+        ASSERT_NE(cache.find("a"), nullptr);
+        EXPECT_EQ(*cache.find("a"), nl::json(1));
+        ASSERT_NE(cache.find("c"), nullptr);
+        EXPECT_EQ(*cache.find("c"), nl::json(3));
+    }
+
+    TEST(completion_cache, replace_and_clear)
+    {
+        completion_cache cache(2);
+        cache.insert("a", 1);
+        cache.insert("a", 2);
+        cache.insert("b", 3);
+        ASSERT_NE(cache.find("a"), nullptr);
+        EXPECT_EQ(*cache.find("a"), nl::json(2));
+        ASSERT_NE(cache.find("b"), nullptr);
+
+        cache.clear();
+        EXPECT_EQ(cache.find("a"), nullptr);
+        EXPECT_EQ(cache.find("b"), nullptr);
+    }
+
+    TEST(completion_cache, request_key)
+    {
+        std::string code = "*** Tasks ***\nTask\n    Log To Console    a";
+        std::size_t in_keyword = code.find("To");
+
+        // Same request, same key
+        EXPECT_EQ(get_key(code, in_keyword, false), get_key(code, in_keyword, false));
+        // The key depends on the rest of the cell, the generation and the extent of the token
+        EXPECT_NE(get_key(code, in_keyword, false), get_key(code + "b", in_keyword, false));
+        EXPECT_NE(get_key(code, in_keyword, false), get_key(code, in_keyword, false, 1));
+        EXPECT_NE(get_key(code, in_keyword, false), get_key(code, in_keyword, true));
+
+        std::string key = get_key(code, in_keyword, true);
+        EXPECT_EQ(key.substr(key.rfind(':') + 1), "Log To Console");
+    }
+
+    TEST(completion_cache, cacheable)
+    {
+        EXPECT_TRUE(is_cacheable(cursor_context::keyword_call));
+        EXPECT_TRUE(is_cacheable(cursor_context::setting));
+        EXPECT_FALSE(is_cacheable(cursor_context::variable_reference));
+        EXPECT_FALSE(is_cacheable(cursor_context::argument));
+    }
+
+    TEST(keyword_index, normalize)
+    {
+        EXPECT_EQ(normalize_keyword("Log To_Console"), "logtoconsole");
+        EXPECT_EQ(normalize_keyword(""), "");
+    }
+
+    TEST(keyword_index, prefix)
+    {
+        keyword_index index;
+        index.add_keywords("BuiltIn", {"Log", "Log Many", "Should Be Equal", "Log To Console"});
+        EXPECT_EQ(index.size(), 4u);
+
+        std::vector<std::string> expected = {"Log", "Log Many", "Log To Console"};
+        EXPECT_EQ(get_names(index.complete("log", 3)), expected);
+        EXPECT_EQ(get_names(index.complete("LOG_m", 1)), std::vector<std::string>({"Log Many"}));
+        // Fuzzy matches follow the prefix matches
+        EXPECT_EQ(index.complete("LOG_m", 3).front()->m_name, "Log Many");
+        EXPECT_EQ(index.complete("LOG_m", 3).size(), 3u);
+        EXPECT_EQ(index.complete("log", 2).size(), 2u);
+    }
+
+    TEST(keyword_index, fuzzy)
+    {
+        keyword_index index;
+        index.add_keywords("BuiltIn", {"Log", "Should Be Equal"});
+
+        std::vector<std::string> names = get_names(index.complete("shouldequal", 5));
+        ASSERT_EQ(names.size(), 1u);
+        EXPECT_EQ(names[0], "Should Be Equal");
+        EXPECT_TRUE(index.complete("xyz", 5).empty());
+    }
+
+    TEST(keyword_index, sources)
+    {
+        keyword_index index;
+        index.add_keywords("BuiltIn", {"Log"});
+        index.add_keywords("BuiltIn", {"log", "Sleep"});
+        index.add_keywords("String", {"Split String"});
+        EXPECT_EQ(index.size(), 3u);
+        EXPECT_TRUE(index.has_source("String"));
+
+        std::size_t generation = index.generation();
+        index.remove_source("String");
+        EXPECT_GT(index.generation(), generation);
+        EXPECT_FALSE(index.has_source("String"));
+        EXPECT_TRUE(index.complete("split", 5).empty());
+        EXPECT_EQ(index.size(), 2u);
+
+        // Compaction keeps the remaining keywords
+        index.remove_source("BuiltIn");
+        EXPECT_EQ(index.size(), 0u);
+        index.add_keywords("Collections", {"Append To List"});
+        EXPECT_EQ(get_names(index.complete("append", 5)), std::vector<std::string>({"Append To List"}));
+    }
+
+    TEST(keyword_index, pending_sources)
+    {
+        keyword_index index;
+        index.add_keywords("BuiltIn", {"Log", "Sleep"});
+        index.add_keywords("String", {"Split String"});
+        index.add_pending_source("BuiltIn", "spec");
+        EXPECT_FALSE(index.has_pending_sources());
+
+        index.add_pending_source("Collections", "spec");
+        EXPECT_TRUE(index.has_pending_sources());
+
+        // Removing most of the entries compacts the index, pending sources stay
+        index.remove_source("BuiltIn");
+        EXPECT_TRUE(index.has_pending_sources());
+
+        std::map<std::string, std::string> pending = index.take_pending_sources();
+        ASSERT_EQ(pending.size(), 1u);
+        EXPECT_EQ(pending.begin()->first, "Collections");
+        EXPECT_FALSE(index.has_pending_sources());
+    }
+}
@@ -0,0 +1,352 @@
+/***************************************************************************
+* Copyright (c) 2020, Martin Renou, Johan Mabille, Sylvain Corlay, and     *
+* Wolf Vollprecht                                                          *
+* Copyright (c) 2020, QuantStack                                           *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "xcell_classifier.hpp"
+#include "xis_complete.hpp"
+#include "xtokenizer.hpp"
+
+namespace xrob
+{
+    namespace
+    {
+        std::vector<token_kind> get_kinds(const std::string& text)
+        {
+            tokenizer tok;
+            tok.tokenize(text);
+            std::vector<token_kind> kinds;
+            for (const token& t : tok.tokens())
+            {
+                kinds.push_back(t.m_kind);
+            }
+            return kinds;
+        }
+
+        std::string get_text(const std::string& text, const token& t)
+        {
+            return text.substr(t.m_offset, t.m_length);
+        }
+
+        void check_same_tokens(const tokenizer& lhs, const tokenizer& rhs)
+        {
+            ASSERT_EQ(lhs.tokens().size(), rhs.tokens().size());
+            for (std::size_t i = 0; i < lhs.tokens().size(); ++i)
+            {
+                EXPECT_EQ(lhs.tokens()[i].m_kind, rhs.tokens()[i].m_kind);
+                EXPECT_EQ(lhs.tokens()[i].m_offset, rhs.tokens()[i].m_offset);
+                EXPECT_EQ(lhs.tokens()[i].m_length, rhs.tokens()[i].m_length);
+                EXPECT_EQ(lhs.tokens()[i].m_line, rhs.tokens()[i].m_line);
+            }
+            ASSERT_EQ(lhs.line_count(), rhs.line_count());
+            EXPECT_TRUE(lhs.get_end_state() == rhs.get_end_state());
+        }
+
+        const std::string sample =
+            "*** Settings ***\n"
+            "Library    SeleniumLibrary\n"
+            "Suite Setup    Open Browser    about:blank\n"
+            "\n"
+            "*** Variables ***\n"
+            "${URL}    https://robotframework.org\n"
+            "\n"
+            "*** Tasks ***\n"
+            "Visit the page\n"
+            "    [Documentation]    Opens the page\n"
+            "    ${title} =    Get Title    # the title\n"
+            "    FOR    ${i}    IN RANGE    3\n"
+            "        Log    ${i}\n"
+            "        ...    console=True\n"
+            "    END\n"
+            "\n"
+            "*** Keywords ***\n"
+            "My Keyword\n"
+            "    [Arguments]    ${arg}\n"
+            "    IF    $arg    Log    yes    ELSE    Log    no\n";
+    }
+
+    TEST(cell_classifier, python_module)
+    {
+        std::string code = "%%python module my_lib\ndef f():\n    pass\n";
+        cell_info cell = classify_cell(code);
+        EXPECT_EQ(cell.m_kind, cell_kind::python_module);
+        EXPECT_EQ(cell.m_module_name.str(), "my_lib");
+        EXPECT_EQ(cell.m_body.str(), "\ndef f():\n    pass\n");
+    }
+
+    TEST(cell_classifier, sections)
+    {
+        cell_info cell = classify_cell(sample);
+        EXPECT_EQ(cell.m_kind, cell_kind::robot);
+        ASSERT_EQ(cell.m_sections.size(), 4u);
+        EXPECT_EQ(cell.m_sections[0].m_kind, section_kind::settings);
+        EXPECT_EQ(cell.m_sections[1].m_kind, section_kind::variables);
+        EXPECT_EQ(cell.m_sections[2].m_kind, section_kind::tasks);
+        EXPECT_EQ(cell.m_sections[3].m_kind, section_kind::keywords);
+        EXPECT_EQ(cell.m_sections[1].m_begin, cell.m_sections[0].m_end);
+    }
+
+    TEST(cell_classifier, task_names)
+    {
+        std::string code = "*** Test Cases ***\nFirst task\n    Log  a\nSecond  No Operation\n";
+        cell_info cell = classify_cell(code);
+        std::vector<std::string> names = get_task_names(cell, code);
+        ASSERT_EQ(names.size(), 2u);
+        EXPECT_EQ(names[0], "First task");
+        EXPECT_EQ(names[1], "Second");
+    }
+
+    TEST(cell_classifier, cursor)
+    {
+        std::string code = "*** Tasks ***\nTask\n    Log  ${na";
+        cell_info cell = classify_cell(code);
+
+        cursor_info at_variable = classify_cursor(cell, code, static_cast<int>(code.size()));
+        EXPECT_EQ(at_variable.m_context, cursor_context::variable_reference);
+        EXPECT_EQ(code.substr(at_variable.m_token_begin), "${na");
+
+        cursor_info at_keyword = classify_cursor(cell, code, static_cast<int>(code.size()) - 6);
+        EXPECT_EQ(at_keyword.m_context, cursor_context::keyword_call);
+    }
+
+    TEST(cell_classifier, cursor_contexts)
+    {
+        auto context_at_end = [](const std::string& code)
+        {
+            return classify_cursor(classify_cell(code), code, static_cast<int>(code.size())).m_context;
+        };
+
+        EXPECT_EQ(context_at_end("*** Tasks ***\nTa"), cursor_context::definition);
+        EXPECT_EQ(context_at_end("*** Tasks ***\nTask\n    ${x} =    Get Ti"), cursor_context::keyword_call);
+        EXPECT_EQ(context_at_end("*** Tasks ***\nTask\n    [Setup]    Open Br"), cursor_context::keyword_call);
+        EXPECT_EQ(context_at_end("*** Tasks ***\nTask\n    FOR    ${i}    IN    a"), cursor_context::argument);
+        EXPECT_EQ(context_at_end("*** Tasks ***\nTask\n    Run Keyword    Lo"), cursor_context::argument);
+        EXPECT_EQ(context_at_end("*** Tasks ***\nTask\n    Log    a\n    ...    b"), cursor_context::argument);
+        EXPECT_EQ(context_at_end("*** Settings ***\nSuite Se"), cursor_context::setting);
+        EXPECT_EQ(context_at_end("*** Settings ***\nSuite Setup    Open Br"), cursor_context::keyword_call);
+        EXPECT_EQ(context_at_end("*** Variables ***\n${na"), cursor_context::variable_reference);
+        EXPECT_EQ(context_at_end("*** Comments ***\nSome te"), cursor_context::other);
+    }
+
+    TEST(is_complete, robot)
+    {
+        EXPECT_EQ(check_is_complete("*** Tasks ***\nTask\n    Log  a\n\n").m_status, "complete");
+        EXPECT_EQ(check_is_complete("*** Settings ***\nLibrary  String").m_status, "complete");
+
+        is_complete_result name = check_is_complete("*** Tasks ***\nTask");
+        EXPECT_EQ(name.m_status, "incomplete");
+        EXPECT_EQ(name.m_indent, "    ");
+
+        is_complete_result block = check_is_complete("*** Tasks ***\nTask\n    FOR  ${i}  IN  a  b\n        Log  ${i}\n\n");
+        EXPECT_EQ(block.m_status, "incomplete");
+        EXPECT_EQ(block.m_indent, "        ");
+
+        EXPECT_EQ(check_is_complete("*** Tasks ***\nTask\n    IF  $x  Log  a\n\n").m_status, "complete");
+        EXPECT_EQ(check_is_complete("*** Tasks ***\nTask\n    END\n\n").m_status, "invalid");
+    }
+
+    TEST(is_complete, python)
+    {
+        EXPECT_EQ(check_is_complete("%%python module m\nx = 1").m_status, "complete");
+        EXPECT_EQ(check_is_complete("%%python module m\nx = (1,").m_status, "incomplete");
+        EXPECT_EQ(check_is_complete("%%python module m\ns = '''abc").m_status, "incomplete");
+
+        is_complete_result def = check_is_complete("%%python module m\ndef f():");
+        EXPECT_EQ(def.m_status, "incomplete");
+        EXPECT_EQ(def.m_indent, "    ");
+    }
+
+    TEST(tokenizer, settings_and_variables)
+    {
+        std::vector<token_kind> expected = {
+            token_kind::header,
+            token_kind::setting, token_kind::argument,
+            token_kind::setting, token_kind::keyword, token_kind::argument,
+            token_kind::header,
+            token_kind::variable, token_kind::argument
+        };
+        std::vector<token_kind> kinds = get_kinds(sample);
+        ASSERT_GE(kinds.size(), expected.size());
+        EXPECT_EQ(std::vector<token_kind>(kinds.begin(), kinds.begin() + static_cast<std::ptrdiff_t>(expected.size())), expected);
+    }
+
+    TEST(tokenizer, statements)
+    {
+        std::string text = "*** Tasks ***\nTask\n    ${x} =    Get Title    # comment\n    [Setup]    Log    a\n";
+        std::vector<token_kind> expected = {
+            token_kind::header, token_kind::name,
+            token_kind::variable, token_kind::keyword, token_kind::comment,
+            token_kind::setting, token_kind::keyword, token_kind::argument
+        };
+        EXPECT_EQ(get_kinds(text), expected);
+
+        tokenizer tok;
+        tok.tokenize(text);
+        EXPECT_EQ(get_text(text, tok.tokens()[2]), "${x} =");
+        EXPECT_EQ(get_text(text, tok.tokens()[3]), "Get Title");
+        EXPECT_EQ(get_text(text, tok.tokens()[4]), "# comment");
+        EXPECT_EQ(tok.tokens()[3].m_line, 2u);
+    }
+
+    TEST(tokenizer, blocks)
+    {
+        std::string text =
+            "*** Keywords ***\n"
+            "Kw\n"
+            "    FOR    ${i}    IN RANGE    3\n"
+            "        IF    $i\n"
+            "            Log    ${i}\n"
+            "        ...    WARN\n"
+            "        ELSE\n"
+            "            No Operation\n"
+            "        END\n";
+
+        tokenizer tok;
+        tok.tokenize(text);
+        EXPECT_EQ(tok.get_line_state(3).m_block_depth, 1u);
+        EXPECT_EQ(tok.get_line_state(4).m_block_depth, 2u);
+        EXPECT_EQ(tok.get_end_state().m_block_depth, 1u);
+
+        std::vector<token_kind> expected = {
+            token_kind::header, token_kind::name,
+            token_kind::control, token_kind::variable, token_kind::control, token_kind::argument,
+            token_kind::control, token_kind::argument,
+            token_kind::keyword, token_kind::variable,
+            token_kind::continuation, token_kind::argument,
+            token_kind::control,
+            token_kind::keyword,
+            token_kind::control
+        };
+        EXPECT_EQ(get_kinds(text), expected);
+    }
+
+    TEST(tokenizer, inline_if)
+    {
+        std::string text = "*** Tasks ***\nT\n    IF    $a    Log    yes    ELSE    Log    no\n";
+        std::vector<token_kind> expected = {
+            token_kind::header, token_kind::name,
+            token_kind::control, token_kind::argument, token_kind::keyword, token_kind::argument,
+            token_kind::control, token_kind::keyword, token_kind::argument
+        };
+        EXPECT_EQ(get_kinds(text), expected);
+
+        tokenizer tok;
+        tok.tokenize(text);
+        EXPECT_EQ(tok.get_end_state().m_block_depth, 0u);
+    }
+
+    TEST(tokenizer, variable_references)
+    {
+        std::string text = "*** Tasks ***\nT\n    Log    Hello ${name}!    @{items}[0][k]    \\${escaped}    ${open\n";
+        tokenizer tok;
+        tok.tokenize(text);
+
+        std::vector<std::pair<token_kind, std::string>> expected = {
+            {token_kind::keyword, "Log"},
+            {token_kind::argument, "Hello "},
+            {token_kind::variable, "${name}"},
+            {token_kind::argument, "!"},
+            {token_kind::variable, "@{items}[0][k]"},
+            {token_kind::argument, "\\${escaped}"},
+            {token_kind::argument, "${open"}
+        };
+        ASSERT_EQ(tok.tokens().size(), expected.size() + 2);
+        for (std::size_t i = 0; i < expected.size(); ++i)
+        {
+            EXPECT_EQ(tok.tokens()[i + 2].m_kind, expected[i].first);
+            EXPECT_EQ(get_text(text, tok.tokens()[i + 2]), expected[i].second);
+        }
+    }
+
+    TEST(tokenizer, continued_keyword)
+    {
+        std::string text = "*** Settings ***\nSuite Setup\n...    Open Browser    about:blank\n";
+        std::vector<token_kind> expected = {
+            token_kind::header,
+            token_kind::setting,
+            token_kind::continuation, token_kind::keyword, token_kind::argument
+        };
+        EXPECT_EQ(get_kinds(text), expected);
+    }
+
+    TEST(tokenizer, find_token)
+    {
+        tokenizer tok;
+        tok.tokenize(sample);
+        std::size_t offset = sample.find("Get Title") + 3;
+        std::size_t index = tok.find_token(offset);
+        ASSERT_LT(index, tok.tokens().size());
+        EXPECT_EQ(get_text(sample, tok.tokens()[index]), "Get Title");
+    }
+
+    TEST(tokenizer, retokenize)
+    {
+        struct edit
+        {
+            std::size_t m_offset;
+            std::size_t m_removed;
+            std::string m_inserted;
+        };
+
+        std::vector<edit> edits = {
+            // Edit inside a keyword call
+            {sample.find("Get Title"), 3, "Fetch"},
+            // New line in the middle of a test
+            {sample.find("    END"), 0, "    Log    inserted\n"},
+            // Opening a block changes the state of all the following lines
+            {sample.find("    END"), 7, ""},
+            // Changing a section header
+            {sample.find("*** Keywords ***"), 16, "*** Tasks ***"},
+            // Append at the end
+            {sample.size(), 0, "    Log    end\n"},
+            // Edit in the first line
+            {0, 3, ""}
+        };
+
+        for (const edit& e : edits)
+        {
+            std::string text = sample;
+            tokenizer incremental;
+            incremental.tokenize(text);
+
+            text.replace(e.m_offset, e.m_removed, e.m_inserted);
+            incremental.retokenize(text, e.m_offset, e.m_removed, e.m_inserted.size());
+
+            tokenizer full;
+            full.tokenize(text);
+            check_same_tokens(incremental, full);
+        }
+    }
+
+    TEST(tokenizer, successive_edits)
+    {
+        std::string text = sample;
+        tokenizer incremental;
+        incremental.tokenize(text);
+
+        // Typing a new step character by character
+        std::string step = "    Click Element    id=submit\n";
+        std::size_t offset = text.find("    END");
+        for (std::size_t i = 0; i < step.size(); ++i)
+        {
+            text.insert(offset + i, 1, step[i]);
+            incremental.retokenize(text, offset + i, 0, 1);
+        }
+
+        tokenizer full;
+        full.tokenize(text);
+        check_same_tokens(incremental, full);
+    }
+}